@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <optional>
+
+#include "mstch/mstch.hpp"
+
+// Request scoped views built on the heap and in an mstch::arena: the *_cycle
+// cases build, render and destroy a view, the *_teardown cases time only the
+// destruction.
+
+static const mstch::compiled_template rows_tmpl{
+    "<table>{{#rows}}<tr><td>{{id}}</td><td>{{name}}</td>"
+    "<td>{{#tags}}{{.}} {{/tags}}</td></tr>{{/rows}}</table>"};
+
+static mstch::node heap_view(std::size_t rows) {
+    mstch::array items;
+    items.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i)
+        items.push_back(mstch::map{
+            {"id", static_cast<int>(i)},
+            {"name", "customer name " + std::to_string(i)},
+            {"tags", mstch::array{
+                std::string{"first tag value"}, std::string{"second tag value"}}}});
+    return mstch::map{{"rows", std::move(items)}};
+}
+
+static mstch::node arena_view(mstch::arena& arena, std::size_t rows) {
+    return arena.map({{"rows", arena.array(rows, [&](std::size_t i) {
+        return arena.map({
+            {"id", static_cast<int>(i)},
+            {"name", arena.string("customer name " + std::to_string(i))},
+            {"tags", arena.array({
+                arena.string("first tag value"),
+                arena.string("second tag value")})}});
+    })}});
+}
+
+static void heap_cycle(benchmark::State& state) {
+    std::string out;
+    for (auto _ : state) {
+        auto view = heap_view(state.range(0));
+        out.clear();
+        mstch::render(rows_tmpl, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void arena_cycle(benchmark::State& state) {
+    std::string out;
+    for (auto _ : state) {
+        mstch::arena arena;
+        auto view = arena_view(arena, state.range(0));
+        out.clear();
+        mstch::render(rows_tmpl, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void heap_teardown(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::optional<mstch::node> view = heap_view(state.range(0));
+        state.ResumeTiming();
+        view.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void arena_teardown(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::optional<mstch::arena> arena;
+        arena.emplace();
+        auto view = arena_view(*arena, state.range(0));
+        state.ResumeTiming();
+        arena.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(heap_cycle)->RangeMultiplier(10)->Range(100, 100000);
+BENCHMARK(arena_cycle)->RangeMultiplier(10)->Range(100, 100000);
+BENCHMARK(heap_teardown)->RangeMultiplier(10)->Range(100, 100000)->Iterations(20);
+BENCHMARK(arena_teardown)->RangeMultiplier(10)->Range(100, 100000)->Iterations(20);
@@ -2,13 +2,13 @@
 
 #include "mstch/mstch.hpp"
 
-static void basic_usage(benchmark::State& state) {
-    std::string comment_tmp{
-        "<div class=\"comments\"><h3>{{header}}</h3><ul>"
-        "{{#comments}}<li class=\"comment\"><h5>{{name}}</h5>"
-        "<p>{{body}}</p></li>{{/comments}}</ul></div>"};
+static const std::string comment_tmp{
+    "<div class=\"comments\"><h3>{{header}}</h3><ul>"
+    "{{#comments}}<li class=\"comment\"><h5>{{name}}</h5>"
+    "<p>{{body}}</p></li>{{/comments}}</ul></div>"};
 
-    auto comment_view = mstch::map{
+static mstch::node comment_view() {
+    return mstch::map{
         {"header", std::string{"My Post Comments"}},
             {"comments", mstch::array{
                 mstch::map{{"name", std::string{"Joe"}}, {"body", std::string{"Thanks for this post!"}}},
@@ -16,11 +16,211 @@ static void basic_usage(benchmark::State& state) {
                 mstch::map{{"name", std::string{"Heather"}}, {"body", std::string{"Thanks for this post!"}}},
                 mstch::map{{"name", std::string{"Kathy"}}, {"body", std::string{"Thanks for this post!"}}},
                 mstch::map{{"name", std::string{"George"}}, {"body", std::string{"Thanks for this post!"}}}}}};
+}
+
+static void basic_usage(benchmark::State& state) {
+    auto view = comment_view();
 
     while (state.KeepRunning())
-        mstch::render(comment_tmp, comment_view);
+        mstch::render(comment_tmp, view);
+}
+
+static void parse_per_call(benchmark::State& state) {
+    auto view = comment_view();
+    std::map<std::string, std::string> partials{
+        {"comment", "<li class=\"comment\"><h5>{{name}}</h5><p>{{body}}</p></li>"}};
+    std::string tmp{
+        "<div class=\"comments\"><h3>{{header}}</h3><ul>"
+        "{{#comments}}{{> comment}}{{/comments}}</ul></div>"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view, partials));
+}
+
+static void precompiled(benchmark::State& state) {
+    auto view = comment_view();
+    mstch::compiled_template tmp{
+        "<div class=\"comments\"><h3>{{header}}</h3><ul>"
+        "{{#comments}}{{> comment}}{{/comments}}</ul></div>",
+        {{"comment", "<li class=\"comment\"><h5>{{name}}</h5><p>{{body}}</p></li>"}}};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+}
+
+static void precompiled_into_buffer(benchmark::State& state) {
+    auto view = comment_view();
+    mstch::compiled_template tmp{comment_tmp};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmp, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+static std::map<std::string, std::string> site_partials() {
+    std::map<std::string, std::string> partials{
+        {"comment", "<li class=\"comment\"><h5>{{name}}</h5><p>{{body}}</p></li>"}};
+    for (int i = 0; i < 150; ++i)
+        partials["shared_" + std::to_string(i)] =
+            "<div class=\"widget\">{{#items}}<span>{{name}}</span>{{/items}}</div>";
+    return partials;
+}
+
+static void partials_map_per_call(benchmark::State& state) {
+    auto view = comment_view();
+    auto partials = site_partials();
+    std::string tmp{"<ul>{{#comments}}{{> comment}}{{/comments}}</ul>"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view, partials));
+}
+
+static void partials_shared_registry(benchmark::State& state) {
+    auto view = comment_view();
+    mstch::partial_registry partials{site_partials()};
+    std::string tmp{"<ul>{{#comments}}{{> comment}}{{/comments}}</ul>"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(mstch::compiled_template{tmp, partials}, view));
+}
+
+static void nested_sections(benchmark::State& state) {
+    mstch::array rows;
+    for (int i = 0; i < 1000; ++i)
+        rows.push_back(mstch::map{
+            {"id", i},
+            {"cells", mstch::array{std::string{"a"}, std::string{"b"}, std::string{"c"}}}});
+    mstch::node view = mstch::map{{"rows", rows}};
+    mstch::compiled_template tmp{
+        "<table>{{#rows}}<tr id=\"{{id}}\">{{#cells}}<td>{{.}}</td>{{/cells}}"
+        "{{^cells}}<td>none</td>{{/cells}}</tr>\n{{/rows}}</table>"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+}
+
+static void large_subtrees(benchmark::State& state) {
+    mstch::array payload;
+    for (int i = 0; i < state.range(0); ++i)
+        payload.push_back(mstch::map{{"key", std::string{"value"}}, {"n", i}});
+    mstch::array items;
+    for (int i = 0; i < 100; ++i)
+        items.push_back(mstch::map{{"name", std::string{"item"}}, {"payload", payload}});
+    mstch::node view = mstch::map{{"items", items}};
+    mstch::compiled_template tmp{"{{#items}}<b>{{name}}</b>{{/items}}"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+}
+
+static void dotted_paths(benchmark::State& state) {
+    mstch::array users;
+    for (int i = 0; i < 1000; ++i)
+        users.push_back(mstch::map{{"user", mstch::map{
+            {"id", i},
+            {"profile", mstch::map{
+                {"name", std::string{"Joe"}},
+                {"email", std::string{"joe@example.com"}}}}}}});
+    mstch::node view = mstch::map{{"users", users}};
+    mstch::compiled_template tmp{
+        "{{#users}}<a href=\"/u/{{user.id}}\">{{user.profile.name}}</a> "
+        "{{user.profile.email}}\n{{/users}}"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+}
+
+static void concurrent_render(benchmark::State& state) {
+    static const mstch::node view = [] {
+        mstch::array comments;
+        for (int i = 0; i < 100; ++i)
+            comments.push_back(mstch::map{
+                {"name", std::string{"Joe"}}, {"body", std::string{"Thanks for this post!"}}});
+        return mstch::map{{"header", std::string{"My Post Comments"}}, {"comments", comments}};
+    }();
+    static const mstch::compiled_template tmp{comment_tmp};
+
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmp, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<class Map>
+static void wide_objects(benchmark::State& state) {
+    std::string tmp_str{"{{#rows}}"};
+    Map row;
+    for (int i = 0; i < 40; ++i) {
+        row["field_" + std::to_string(i)] = std::string{"value"};
+        if (i % 4 == 0)
+            tmp_str += "{{field_" + std::to_string(i) + "}} ";
+    }
+    tmp_str += "{{/rows}}";
+    mstch::node view = Map{{"rows", mstch::array(100, row)}};
+    mstch::compiled_template tmp{tmp_str};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+    // std::map lookups can't be cached and aren't counted
+    auto lookups = tmp.lookups();
+    if (lookups.hits + lookups.misses != 0)
+        state.counters["lookup_hit_rate"] =
+            double(lookups.hits) / double(lookups.hits + lookups.misses);
+}
+
+static void escape_throughput(benchmark::State& state) {
+    std::string text;
+    for (int i = 0; text.size() < 64 * 1024; ++i)
+        text += (i % 100 < state.range(0)) ? '<' : 'a';
+    mstch::node view = mstch::map{{"text", text}};
+    mstch::compiled_template tmp{"{{text}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmp, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+static void numeric_table(benchmark::State& state) {
+    mstch::array rows;
+    for (int i = 0; i < 1000; ++i)
+        rows.push_back(mstch::map{
+            {"id", std::int64_t{1000000000000} + i},
+            {"count", i * 7},
+            {"price", i * 1.37},
+            {"total", std::uint64_t(i) * 123456789u}});
+    mstch::node view = mstch::map{{"rows", rows}};
+    mstch::compiled_template tmp{
+        "{{#rows}}<tr><td>{{id}}</td><td>{{count}}</td>"
+        "<td>{{price}}</td><td>{{total}}</td></tr>\n{{/rows}}"};
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmp, view));
+    state.SetItemsProcessed(state.iterations() * 4000);
 }
 
 BENCHMARK(basic_usage);
+BENCHMARK(parse_per_call);
+BENCHMARK(precompiled);
+BENCHMARK(precompiled_into_buffer);
+BENCHMARK(partials_map_per_call);
+BENCHMARK(partials_shared_registry);
+BENCHMARK(nested_sections);
+BENCHMARK(dotted_paths);
+BENCHMARK(large_subtrees)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK_TEMPLATE(wide_objects, mstch::map);
+BENCHMARK_TEMPLATE(wide_objects, mstch::flat_map);
+BENCHMARK(numeric_table);
+BENCHMARK(escape_throughput)->Arg(0)->Arg(1)->Arg(10)->Arg(50);
+BENCHMARK(concurrent_render)->ThreadRange(1, 16)->UseRealTime();
 
 BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include "mstch/mstch.hpp"
+
+// Rendering plain C++ structs: converted into maps and arrays before every
+// render, against bound with mstch::bind and read in place.
+
+namespace {
+
+struct line_item {
+    std::string sku;
+    std::string title;
+    int quantity;
+    double price;
+};
+
+struct invoice {
+    std::string number;
+    std::string customer;
+    std::string address;
+    bool paid;
+    std::vector<line_item> items;
+};
+
+}
+
+MSTCH_BIND(line_item,
+    MSTCH_FIELD(sku), MSTCH_FIELD(title), MSTCH_FIELD(quantity),
+    MSTCH_FIELD(price))
+MSTCH_BIND(invoice,
+    MSTCH_FIELD(number), MSTCH_FIELD(customer), MSTCH_FIELD(address),
+    MSTCH_FIELD(paid), MSTCH_FIELD(items))
+
+static const std::string invoice_template{
+    "Invoice {{number}} for {{customer}}, {{address}}\n"
+    "{{#items}}\n"
+    "{{sku}} {{title}} {{quantity}} x {{price}}\n"
+    "{{/items}}\n"
+    "{{^paid}}Payment due{{/paid}}\n"};
+
+static invoice make_invoice(std::size_t items) {
+    invoice result{"INV-2024-0042", "Ada Lovelace",
+        "12 St James's Square, London", false, {}};
+    for (std::size_t i = 0; i < items; ++i)
+        result.items.push_back({"SKU-" + std::to_string(100000 + i),
+            "Analytical engine part " + std::to_string(i),
+            static_cast<int>(i % 7 + 1), 19.99 + i});
+    return result;
+}
+
+static mstch::node convert(const invoice& value) {
+    mstch::array items;
+    items.reserve(value.items.size());
+    for (auto& item: value.items)
+        items.push_back(mstch::map{
+            {"sku", item.sku}, {"title", item.title},
+            {"quantity", item.quantity}, {"price", item.price}});
+    return mstch::map{
+        {"number", value.number}, {"customer", value.customer},
+        {"address", value.address}, {"paid", value.paid},
+        {"items", std::move(items)}};
+}
+
+static void binding_convert(benchmark::State& state) {
+    const auto value = make_invoice(state.range(0));
+    const mstch::compiled_template tmplt{invoice_template};
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmplt, convert(value), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void binding_bound(benchmark::State& state) {
+    const auto value = make_invoice(state.range(0));
+    const mstch::compiled_template tmplt{invoice_template};
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmplt, mstch::bind(value), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(binding_convert)->Arg(1)->Arg(100)->Arg(10000);
+BENCHMARK(binding_bound)->Arg(1)->Arg(100)->Arg(10000);
@@ -0,0 +1,48 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every block carries its size in a header in front of it. This lives in its
+// own translation unit so the replacements are never inlined into callers.
+
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+std::atomic<std::size_t> live_byte_count{0};
+
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+}
+
+std::size_t allocation_counter::allocations() {
+    return allocation_count.load();
+}
+
+std::size_t allocation_counter::live_bytes() {
+    return live_byte_count.load();
+}
+
+void* operator new(std::size_t size) {
+    auto block = static_cast<char*>(std::malloc(size + header_size));
+    if (!block)
+        throw std::bad_alloc{};
+    *reinterpret_cast<std::size_t*>(block) = size;
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    live_byte_count.fetch_add(size, std::memory_order_relaxed);
+    return block + header_size;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr)
+        return;
+    auto block = static_cast<char*>(ptr) - header_size;
+    live_byte_count.fetch_sub(
+        *reinterpret_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
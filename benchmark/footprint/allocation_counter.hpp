@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap allocations of the whole footprint binary, counted by the replaced
+// global operator new and delete in allocation_counter.cpp.
+namespace allocation_counter {
+
+std::size_t allocations();
+std::size_t live_bytes();
+
+}
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include "mstch/mstch.hpp"
+#include "allocation_counter.hpp"
+
+// The memory a compiled template keeps, reported next to its source size.
+// This is a binary of its own: counting every allocation would slow down the
+// allocations of all other benchmarks.
+
+static std::string make_page(std::size_t size) {
+    const std::string chunk{
+        "<tr class=\"{{#odd}}odd{{/odd}}{{^odd}}even{{/odd}}\">\n"
+        "  <td>{{user.name}}</td><td>{{{user.bio}}}</td>\n"
+        "  {{#tags}}<span>{{.}}</span> {{/tags}}\n"
+        "  {{! per row comment }}\n"
+        "</tr>\n"};
+    std::string tmp;
+    tmp.reserve(size + chunk.size());
+    while (tmp.size() < size)
+        tmp += chunk;
+    return tmp;
+}
+
+static void memory_footprint(benchmark::State& state) {
+    auto tmp = make_page(state.range(0));
+    std::size_t retained = 0, compile_allocations = 0;
+
+    for (auto _ : state) {
+        auto allocations_before = allocation_counter::allocations();
+        auto bytes_before = allocation_counter::live_bytes();
+        mstch::compiled_template compiled{tmp};
+        retained = allocation_counter::live_bytes() - bytes_before;
+        compile_allocations =
+            allocation_counter::allocations() - allocations_before;
+        benchmark::DoNotOptimize(compiled);
+    }
+    state.counters["retained_bytes"] = static_cast<double>(retained);
+    state.counters["bytes_per_source_byte"] =
+        static_cast<double>(retained) / tmp.size();
+    state.counters["allocations"] = static_cast<double>(compile_allocations);
+    state.SetBytesProcessed(state.iterations() * tmp.size());
+}
+
+BENCHMARK(memory_footprint)
+    ->Arg(10 << 10)->Arg(100 << 10)->Arg(500 << 10)->Arg(2 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include "mstch/mstch.hpp"
+
+// Parse throughput of multi-megabyte templates with different shapes. The
+// bytes_per_second column is the parse rate in MB/s.
+
+static const std::string email_chunk{
+    "<table width=\"100%\" style=\"border: 0; padding: 0\">\n"
+    "  <tr><td class=\"greeting\">Dear {{customer.name}},</td></tr>\n"
+    "  <tr><td>Your order {{order.id}} shipped on {{order.date}}. We hope\n"
+    "  you enjoy it, and thank you for shopping with us once again.</td></tr>\n"
+    "  {{#order.items}}<tr><td>{{name}}</td><td>{{price}}</td></tr>{{/order.items}}\n"
+    "</table>\n"};
+
+static const std::string text_chunk{
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+    "tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim "
+    "veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea "
+    "commodo consequat. {{footnote}}\n"};
+
+static const std::string tag_chunk{
+    "{{#a}}{{b}}{{/a}}{{^c}}{{{d}}}{{/c}}{{e.f.g}}{{! x }}{{&h}}\n"};
+
+static const std::string style_chunk{
+    "<style>.btn { color: #fff; } .row { margin: 0 { } }</style>\n"
+    "<script>if (a) { b({ c: 1 }); } {{script_var}}</script>\n"};
+
+static void parse_throughput(benchmark::State& state, const std::string& chunk) {
+    std::string tmp;
+    while (tmp.size() < static_cast<std::size_t>(state.range(0)))
+        tmp += chunk;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::compiled_template{tmp});
+    state.SetBytesProcessed(state.iterations() * tmp.size());
+}
+
+BENCHMARK_CAPTURE(parse_throughput, email, email_chunk)
+    ->Arg(1 << 20)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(parse_throughput, plain_text, text_chunk)
+    ->Arg(1 << 20)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(parse_throughput, dense_tags, tag_chunk)
+    ->Arg(1 << 20)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(parse_throughput, braces, style_chunk)
+    ->Arg(1 << 20)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
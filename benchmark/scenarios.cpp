@@ -0,0 +1,315 @@
+#include <benchmark/benchmark.h>
+
+#include "mstch/mstch.hpp"
+
+// Scenario suite: every case reports the bytes it reads (parsing) or writes
+// (rendering) and the number of items it handles, so results can be
+// compared across versions.
+
+static std::string make_template(std::size_t size) {
+    const std::string chunk{
+        "<div class=\"row\">\n"
+        "  {{! a comment }}\n"
+        "  <h2>{{title}}</h2>\n"
+        "  {{#items}}<span>{{name}}</span>{{/items}}\n"
+        "  {{^empty}}<p>{{{body}}}</p>{{/empty}}\n"
+        "</div>\n"};
+    std::string tmp;
+    tmp.reserve(size + chunk.size());
+    while (tmp.size() < size)
+        tmp += chunk;
+    return tmp;
+}
+
+static void scenario_parse(benchmark::State& state) {
+    auto tmp = make_template(state.range(0));
+    std::size_t tags = 0;
+    for (std::size_t pos = 0; (pos = tmp.find("{{", pos)) != std::string::npos; ++pos)
+        ++tags;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::compiled_template{tmp});
+    state.SetBytesProcessed(state.iterations() * tmp.size());
+    state.SetItemsProcessed(state.iterations() * tags);
+}
+
+static void scenario_deep_nesting(benchmark::State& state) {
+    auto depth = state.range(0);
+    std::string tmp;
+    for (int i = 0; i < depth; ++i)
+        tmp += "{{#level}}<" + std::to_string(i) + ">{{name}}";
+    for (int i = 0; i < depth; ++i)
+        tmp += "{{/level}}";
+    mstch::node view = mstch::map{{"name", std::string{"leaf"}}};
+    for (int i = 0; i < depth; ++i)
+        view = mstch::map{{"level", view}, {"name", std::string{"inner"}}};
+    mstch::compiled_template compiled{tmp};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * depth);
+}
+
+static void scenario_array(benchmark::State& state) {
+    mstch::array items;
+    items.reserve(state.range(0));
+    for (int i = 0; i < state.range(0); ++i)
+        items.push_back(mstch::map{{"id", i}, {"name", std::string{"item"}}});
+    mstch::node view = mstch::map{{"items", std::move(items)}};
+    mstch::compiled_template compiled{
+        "<ul>{{#items}}<li id=\"{{id}}\">{{name}}</li>{{/items}}</ul>"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void scenario_array_parallel(benchmark::State& state) {
+    mstch::array items;
+    items.reserve(100000);
+    for (int i = 0; i < 100000; ++i)
+        items.push_back(mstch::map{{"id", i}, {"name", std::string{"item"}}});
+    mstch::node view = mstch::map{{"items", std::move(items)}};
+    mstch::thread_pool pool(state.range(0));
+    auto compiled = mstch::compiled_template{
+        "<ul>{{#items}}<li id=\"{{id}}\">{{name}}</li>{{/items}}</ul>"}
+        .parallel(pool, 1000);
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * 100000);
+}
+
+static void scenario_batch(benchmark::State& state) {
+    std::vector<mstch::node> roots;
+    for (int i = 0; i < 10000; ++i)
+        roots.push_back(mstch::map{
+            {"name", "user" + std::to_string(i)},
+            {"email", "user" + std::to_string(i) + "@example.com"},
+            {"orders", mstch::array(5, mstch::map{
+                {"id", i}, {"total", 9.99}})}});
+    mstch::thread_pool pool(state.range(0));
+    mstch::compiled_template compiled{
+        "<p>Dear {{name}} &lt;{{email}}&gt;,</p>\n"
+        "<ul>{{#orders}}<li>#{{id}}: {{total}}</li>{{/orders}}</ul>\n"};
+
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        auto outputs = mstch::render_batch(compiled, roots, pool);
+        bytes = 0;
+        for (auto& output: outputs)
+            bytes += output.size();
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetItemsProcessed(state.iterations() * roots.size());
+}
+
+static void scenario_partials(benchmark::State& state) {
+    std::map<std::string, std::string> partials{
+        {"header", "<header>{{> nav}}</header>\n"},
+        {"nav", "<nav>{{#links}}{{> link}}{{/links}}</nav>"},
+        {"link", "<a href=\"{{url}}\">{{label}}</a>"},
+        {"card", "<div class=\"card\">{{> title}}<p>{{body}}</p></div>\n"},
+        {"title", "<h3>{{title}}</h3>"},
+        {"footer", "<footer>{{copyright}}</footer>\n"}};
+    for (int i = 0; i < 150; ++i)
+        partials["unused_" + std::to_string(i)] = "<p>{{unused}}</p>";
+    std::string tmp{"{{> header}}"};
+    for (int i = 0; i < state.range(0); ++i)
+        tmp += "{{#card}}{{> card}}{{/card}}";
+    tmp += "{{> footer}}";
+    mstch::node view = mstch::map{
+        {"links", mstch::array{
+            mstch::map{{"url", std::string{"/"}}, {"label", std::string{"Home"}}},
+            mstch::map{{"url", std::string{"/about"}}, {"label", std::string{"About"}}}}},
+        {"card", mstch::map{
+            {"title", std::string{"Title"}}, {"body", std::string{"Body text"}}}},
+        {"copyright", std::string{"(c) mstch"}}};
+    mstch::compiled_template compiled{tmp, partials};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * (state.range(0) + 2));
+}
+
+static void scenario_lambdas(benchmark::State& state) {
+    mstch::node view = mstch::map{
+        {"items", mstch::array(state.range(0), mstch::map{
+            {"name", std::string{"item"}}})},
+        {"upper", mstch::lambda{[]() -> mstch::node {
+            return std::string{"CONSTANT"};
+        }}},
+        {"bold", mstch::lambda{[](const std::string& text) -> mstch::node {
+            return "<b>" + text + "</b>";
+        }}}};
+    mstch::compiled_template compiled{
+        "{{#items}}{{upper}} {{#bold}}{{name}}{{/bold}}\n{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+static void scenario_lambda_templates(benchmark::State& state) {
+    mstch::node view = mstch::map{
+        {"items", mstch::array(state.range(0), mstch::map{
+            {"name", std::string{"item"}}})},
+        {"link", mstch::lambda{[]() -> mstch::node {
+            return std::string{"<a href=\"/{{name}}\">{{name}}</a>"};
+        }}}};
+    mstch::compiled_template compiled{"{{#items}}{{{link}}}\n{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// a wrapper lambda taking the section text (0) or the compiled section (1)
+static void scenario_section_lambda(benchmark::State& state) {
+    mstch::node wrap;
+    if (state.range(0) == 0)
+        wrap = mstch::lambda{[](const std::string& text) -> mstch::node {
+            return "<div>" + text + "</div>";
+        }};
+    else
+        wrap = mstch::lambda{[](const mstch::section& body) -> mstch::node {
+            return "<div>" + body.render() + "</div>";
+        }};
+    mstch::node view = mstch::map{
+        {"items", mstch::array(1000, mstch::map{
+            {"id", 42}, {"name", std::string{"item"}}})},
+        {"wrap", wrap}};
+    mstch::compiled_template compiled{
+        "{{#items}}{{#wrap}}<b>{{id}}</b> {{name}} {{name}}{{/wrap}}\n{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+class orders_object: public mstch::object {
+public:
+    explicit orders_object(mstch::memoize policy) {
+        register_methods(this, {
+            {"name", &orders_object::name},
+            {"orders", &orders_object::orders}}, policy);
+    }
+
+    mstch::node name() { return std::string{"user"}; }
+
+    mstch::node orders() {
+        mstch::array orders;
+        for (int i = 0; i < 20; ++i)
+            orders.push_back(mstch::map{{"id", i}, {"total", i * 1.5}});
+        return orders;
+    }
+};
+
+// an object getter used three times per item, argument is the memoize policy
+static void scenario_object_memoize(benchmark::State& state) {
+    auto policy = static_cast<mstch::memoize>(state.range(0));
+    mstch::node view = mstch::map{
+        {"items", mstch::array(100, mstch::map{{"id", 1}})},
+        {"user", std::make_shared<orders_object>(policy)}};
+    mstch::compiled_template compiled{
+        "{{#items}}{{user.name}}:{{#user.orders}}{{id}} {{/user.orders}}"
+        "{{#user.orders.0}}{{total}}{{/user.orders.0}}\n{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * 100);
+}
+
+static void scenario_escape(benchmark::State& state) {
+    std::string text;
+    for (int i = 0; text.size() < 256; ++i)
+        text += (i % 4 == 0) ? "<a href=\"/x\">&amp;</a>" : "plain text ";
+    mstch::node view = mstch::map{
+        {"items", mstch::array(state.range(0), mstch::map{{"text", text}})}};
+    mstch::compiled_template compiled{"{{#items}}<p>{{text}}</p>{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void scenario_dotted_paths(benchmark::State& state) {
+    auto depth = state.range(0);
+    mstch::node leaf = std::string{"value"};
+    std::string path{"a"};
+    for (int i = 1; i < depth; ++i)
+        path += ".a";
+    for (int i = 0; i < depth; ++i)
+        leaf = mstch::map{{"a", leaf}};
+    mstch::node view = mstch::map{{"items", mstch::array(1000, leaf)}};
+    mstch::compiled_template compiled{"{{#items}}{{" + path + "}}\n{{/items}}"};
+    std::string out;
+
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(compiled, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK(scenario_parse)
+    ->Arg(1 << 10)->Arg(10 << 10)->Arg(100 << 10)->Arg(1 << 20)->Arg(10 << 20)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(scenario_deep_nesting)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK(scenario_array)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK(scenario_array_parallel)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK(scenario_batch)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK(scenario_partials)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK(scenario_lambdas)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(scenario_lambda_templates)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(scenario_section_lambda)->Arg(0)->Arg(1);
+BENCHMARK(scenario_object_memoize)->DenseRange(0, 2);
+BENCHMARK(scenario_escape)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(scenario_dotted_paths)->DenseRange(1, 8, 1);
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include "mstch/mstch.hpp"
+#include "mstch/static_template.hpp"
+
+// The same templates parsed on every render, compiled once at run time and
+// parsed at compile time as mstch::static_template.
+
+static constexpr char log_line[] =
+    "{{time}} [{{level}}] {{service}}: {{message}} "
+    "(request={{request.id}} user={{request.user}})\n";
+
+static constexpr char json_envelope[] =
+    "{\n"
+    "  \"status\": \"{{status}}\",\n"
+    "  \"items\": [\n"
+    "    {{#items}}\n"
+    "    {\"id\": {{id}}, \"name\": \"{{name}}\"},\n"
+    "    {{/items}}\n"
+    "  ],\n"
+    "  {{^error}}\n"
+    "  \"error\": null\n"
+    "  {{/error}}\n"
+    "}\n";
+
+static mstch::node log_view() {
+    return mstch::map{
+        {"time", std::string{"2024-01-01T00:00:00Z"}},
+        {"level", std::string{"info"}},
+        {"service", std::string{"frontend"}},
+        {"message", std::string{"request handled"}},
+        {"request", mstch::map{
+            {"id", std::string{"8f2c"}}, {"user", 42}}}};
+}
+
+static mstch::node envelope_view() {
+    mstch::array items;
+    for (int i = 0; i < 10; ++i)
+        items.push_back(mstch::map{
+            {"id", i}, {"name", "item " + std::to_string(i)}});
+    return mstch::map{{"status", std::string{"ok"}}, {"items", items}};
+}
+
+template<const char* Source, mstch::node (*View)()>
+static void runtime_parse(benchmark::State& state) {
+    const auto view = View();
+    const std::string tmplt{Source};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mstch::render(tmplt, view));
+}
+
+template<const char* Source, mstch::node (*View)()>
+static void runtime_compiled(benchmark::State& state) {
+    const auto view = View();
+    const mstch::compiled_template tmplt{Source};
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmplt, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+template<const char* Source, mstch::node (*View)()>
+static void compile_time(benchmark::State& state) {
+    const auto view = View();
+    const mstch::static_template<Source> tmplt;
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        mstch::render(tmplt, view, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+BENCHMARK_TEMPLATE(runtime_parse, log_line, log_view);
+BENCHMARK_TEMPLATE(runtime_compiled, log_line, log_view);
+BENCHMARK_TEMPLATE(compile_time, log_line, log_view);
+BENCHMARK_TEMPLATE(runtime_parse, json_envelope, envelope_view);
+BENCHMARK_TEMPLATE(runtime_compiled, json_envelope, envelope_view);
+BENCHMARK_TEMPLATE(compile_time, json_envelope, envelope_view);
@@ -3,40 +3,292 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <functional>
+#include <initializer_list>
+#include <iosfwd>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <cstdint>
+#include <cstring>
 #include <variant>
+#include <algorithm>
 
 namespace mstch {
 
+using escape_function = std::function<std::string(const std::string&)>;
+
+class section;
+
 struct config {
-  static std::function<std::string(const std::string&)> escape;
+  static escape_function escape;
+  // number of templates compiled from lambda results that each thread keeps
+  // around, 0 disables the cache
+  static std::atomic<std::size_t> lambda_cache_size;
+};
+
+// How often the methods of an mstch::object are called
+enum class memoize {
+  never,      // on every access
+  per_render, // once per render, the result is kept until it is done
+  per_object  // once, the result is kept as long as the object
 };
 
 namespace internal {
 
+// Registered methods get consecutive slots. The name of a method only has to
+// be looked up once, calling it by slot goes straight to the member function.
 template<class N>
 class object_t {
  public:
-  const N& at(const std::string& name) const {
-    cache[name] = (methods.at(name))();
-    return cache[name];
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  object_t() = default;
+
+  // copies the registered methods, but not the memoized results
+  object_t(const object_t& other):
+      m_methods(other.m_methods), m_slots(other.m_slots)
+  {
+  }
+
+  object_t& operator=(const object_t& other) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_methods = other.m_methods;
+    m_slots = other.m_slots;
+    m_results.clear();
+    return *this;
+  }
+
+  N at(const std::string& name) const {
+    auto index = slot(name);
+    if (index == npos)
+      throw std::out_of_range("mstch: object has no method " + name);
+    return m_methods[index].policy == memoize::per_object ?
+        memoized(index) : invoke(index);
   }
 
   bool has(const std::string name) const {
-    return methods.count(name) != 0;
+    return slot(name) != npos;
+  }
+
+  std::size_t slot(std::string_view name) const {
+    auto it = m_slots.find(name);
+    return it == m_slots.end() ? npos : it->second;
+  }
+
+  std::size_t size() const {
+    return m_methods.size();
+  }
+
+  const std::string& name(std::size_t slot) const {
+    return m_methods[slot].name;
+  }
+
+  memoize policy(std::size_t slot) const {
+    return m_methods[slot].policy;
+  }
+
+  // calls the method, whatever its policy
+  N invoke(std::size_t slot) const {
+    auto& method = m_methods[slot];
+    return method.call(method);
+  }
+
+  // the result of the method's first call. The method runs without the lock
+  // held, so it may use the object itself; threads calling it at the same
+  // time may each run it, the first result to be stored is kept.
+  const N& memoized(std::size_t slot) const {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (slot < m_results.size() && m_results[slot])
+        return *m_results[slot];
+    }
+    auto result = std::make_unique<const N>(invoke(slot));
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_results.size() <= slot)
+      m_results.resize(m_methods.size());
+    if (!m_results[slot])
+      m_results[slot] = std::move(result);
+    return *m_results[slot];
   }
 
  protected:
   template<class S>
-  void register_methods(S* s, std::map<std::string,N(S::*)()> methods) {
+  void register_methods(
+      S* s,
+      std::map<std::string,N(S::*)()> methods,
+      memoize policy = memoize::never)
+  {
     for(auto& item: methods)
-      this->methods.insert({item.first, std::bind(item.second, s)});
+      register_method(item.first, s, item.second, policy);
+  }
+
+  // returns the slot of the method, an existing method of the same name is
+  // kept
+  template<class S>
+  std::size_t register_method(
+      const std::string& name,
+      S* s,
+      N(S::*method)(),
+      memoize policy = memoize::never)
+  {
+    static_assert(sizeof(method) <= sizeof(method_type::pointer),
+        "member function pointer too large");
+    auto it = m_slots.find(name);
+    if (it != m_slots.end())
+      return it->second;
+    method_type entry{name, s, &call_method<S>, policy, {}};
+    std::memcpy(entry.pointer, &method, sizeof(method));
+    m_methods.push_back(std::move(entry));
+    return m_slots[name] = m_methods.size() - 1;
+  }
+
+ private:
+  struct method_type {
+    std::string name;
+    void* self;
+    N (*call)(const method_type& method);
+    memoize policy;
+    alignas(void*) unsigned char pointer[2 * sizeof(void*)];
+  };
+
+  template<class S>
+  static N call_method(const method_type& method) {
+    N(S::*pointer)();
+    std::memcpy(&pointer, method.pointer, sizeof(pointer));
+    return (static_cast<S*>(method.self)->*pointer)();
+  }
+
+  std::vector<method_type> m_methods;
+  std::map<std::string, std::size_t, std::less<>> m_slots;
+  mutable std::mutex m_mutex;
+  mutable std::vector<std::unique_ptr<const N>> m_results;
+};
+
+template<class N>
+class flat_map_t {
+ public:
+  using value_type = std::pair<std::string, N>;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  flat_map_t() = default;
+
+  flat_map_t(std::initializer_list<value_type> items) {
+    reserve(items.size());
+    for (auto& item: items)
+      insert(item);
+  }
+
+  const_iterator begin() const { return m_entries.begin(); }
+  const_iterator end() const { return m_entries.end(); }
+  std::size_t size() const { return m_entries.size(); }
+  bool empty() const { return m_entries.empty(); }
+
+  const_iterator find(std::string_view key) const {
+    auto index = lookup(key);
+    return index == npos ? end() : begin() + index;
+  }
+
+  std::size_t count(std::string_view key) const {
+    return lookup(key) == npos ? 0 : 1;
+  }
+
+  const N& at(std::string_view key) const {
+    auto index = lookup(key);
+    if (index == npos)
+      throw std::out_of_range("mstch::flat_map::at");
+    return m_entries[index].second;
+  }
+
+  N& at(std::string_view key) {
+    return const_cast<N&>(static_cast<const flat_map_t&>(*this).at(key));
+  }
+
+  N& operator[](std::string_view key) {
+    auto index = lookup(key);
+    if (index == npos)
+      return emplace_new(std::string{key}, N{});
+    return m_entries[index].second;
+  }
+
+  std::pair<const_iterator, bool> insert(value_type item) {
+    return emplace(std::move(item.first), std::move(item.second));
+  }
+
+  template<class... Args>
+  std::pair<const_iterator, bool> emplace(std::string key, Args&&... args) {
+    auto index = lookup(key);
+    if (index != npos)
+      return {begin() + index, false};
+    emplace_new(std::move(key), std::forward<Args>(args)...);
+    return {end() - 1, true};
+  }
+
+  void reserve(std::size_t size) {
+    m_entries.reserve(size);
+    if (size * 2 > m_slots.size())
+      rehash(size * 2);
+  }
+
+  void clear() {
+    m_entries.clear();
+    m_slots.assign(m_slots.size(), 0);
   }
 
  private:
-  std::map<std::string, std::function<N()>> methods;
-  mutable std::map<std::string, N> cache;
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  // insertion ordered entries, m_slots is an open addressing (linear
+  // probing) table holding entry index + 1, or 0 for an empty slot
+  std::vector<value_type> m_entries;
+  std::vector<std::uint32_t> m_slots;
+
+  std::size_t lookup(std::string_view key) const {
+    if (m_slots.empty())
+      return npos;
+    auto mask = m_slots.size() - 1;
+    for (auto slot = std::hash<std::string_view>{}(key) & mask;;
+        slot = (slot + 1) & mask)
+    {
+      auto entry = m_slots[slot];
+      if (entry == 0)
+        return npos;
+      if (m_entries[entry - 1].first == key)
+        return entry - 1;
+    }
+  }
+
+  template<class... Args>
+  N& emplace_new(std::string key, Args&&... args) {
+    if ((m_entries.size() + 1) * 2 > m_slots.size())
+      rehash((m_entries.size() + 1) * 2);
+    m_entries.emplace_back(std::piecewise_construct,
+        std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    place(m_entries.size() - 1);
+    return m_entries.back().second;
+  }
+
+  void rehash(std::size_t min_slots) {
+    std::size_t slots = 8;
+    while (slots < min_slots)
+      slots *= 2;
+    m_slots.assign(slots, 0);
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+      place(i);
+  }
+
+  void place(std::size_t index) {
+    auto mask = m_slots.size() - 1;
+    auto slot = std::hash<std::string_view>{}(m_entries[index].first) & mask;
+    while (m_slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    m_slots[slot] = static_cast<std::uint32_t>(index + 1);
+  }
 };
 
 template<class T, class N>
@@ -45,17 +297,23 @@ class is_fun {
   using not_fun = char;
   using fun_without_args = char[2];
   using fun_with_args = char[3];
+  using fun_with_section = char[4];
   template <typename U, U> struct really_has;
   template <typename C> static fun_without_args& test(
       really_has<N(C::*)() const, &C::operator()>*);
   template <typename C> static fun_with_args& test(
       really_has<N(C::*)(const std::string&) const,
       &C::operator()>*);
+  template <typename C> static fun_with_section& test(
+      really_has<N(C::*)(const section&) const,
+      &C::operator()>*);
   template <typename> static not_fun& test(...);
 
  public:
   static bool const no_args = sizeof(test<T>(0)) == sizeof(fun_without_args);
   static bool const has_args = sizeof(test<T>(0)) == sizeof(fun_with_args);
+  static bool const has_section =
+      sizeof(test<T>(0)) == sizeof(fun_with_section);
 };
 
 template<class N>
@@ -80,14 +338,157 @@ class lambda_t {
   {
   }
 
+  template<class F>
+  lambda_t(F f, typename std::enable_if<is_fun<F, N>::has_section>::type* = 0):
+      section_fun([f](node_renderer<N> renderer, const section& body) {
+        return renderer(f(body));
+      })
+  {
+  }
+
   std::string operator()(node_renderer<N> renderer,
       const std::string& text = "") const
   {
     return fun(renderer, text);
   }
 
+  // lambdas taking the compiled section instead of its text
+  bool takes_section() const {
+    return static_cast<bool>(section_fun);
+  }
+
+  std::string operator()(node_renderer<N> renderer, const section& body) const {
+    return section_fun(renderer, body);
+  }
+
  private:
   std::function<std::string(node_renderer<N> renderer, const std::string&)> fun;
+  std::function<std::string(node_renderer<N> renderer, const section&)>
+      section_fun;
+};
+
+}
+
+// A string a node only points to, for strings kept in an mstch::arena and
+// string fields of bound structs. The characters have to outlive the render.
+class string_view_node {
+ public:
+  string_view_node(const char* data, std::size_t size):
+      m_data(data), m_size(size)
+  {
+  }
+  std::string_view view() const { return {m_data, m_size}; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+ private:
+  const char* m_data;
+  std::size_t m_size;
+};
+
+// Non-owning views of values built in an mstch::arena, see below.
+
+namespace internal {
+
+template<class N>
+class arena_array_t {
+ public:
+  arena_array_t(const N* items, std::size_t size): m_items(items), m_size(size) {}
+  const N* begin() const { return m_items; }
+  const N* end() const { return m_items + m_size; }
+  const N& operator[](std::size_t index) const { return m_items[index]; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+ private:
+  const N* m_items;
+  std::size_t m_size;
+};
+
+// entries sorted by key, the first of equal keys is found
+template<class N>
+class arena_map_t {
+ public:
+  using value_type = std::pair<std::string_view, N>;
+
+  arena_map_t(const value_type* entries, std::size_t size):
+      m_entries(entries), m_size(size)
+  {
+  }
+  const value_type* begin() const { return m_entries; }
+  const value_type* end() const { return m_entries + m_size; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  const value_type* find(std::string_view key) const {
+    auto it = std::lower_bound(begin(), end(), key,
+        [](const value_type& entry, std::string_view key) {
+          return entry.first < key;
+        });
+    return it != end() && it->first == key ? it : end();
+  }
+
+ private:
+  const value_type* m_entries;
+  std::size_t m_size;
+};
+
+template<class N>
+struct binding_field_t {
+  std::string_view name;
+  N (*get)(const void* self);
+};
+
+// How the renderer reads a C++ value bound with mstch::bind: a struct has
+// fields, a container has items, which are bound as they are visited.
+template<class N>
+struct binding_type_t {
+  const binding_field_t<N>* fields;
+  std::size_t size;
+  bool (*empty)(const void* self);
+  void (*each)(const void* self, void* visitor,
+      void (*visit)(void* visitor, const N& item));
+};
+
+// Non-owning view of a bound C++ value, which has to outlive the render
+template<class N>
+class bound_t {
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  bound_t(const void* self, const binding_type_t<N>& type):
+      m_self(self), m_type(&type)
+  {
+  }
+
+  bool sequence() const { return m_type->each != nullptr; }
+
+  // fields of structs
+  std::size_t size() const { return m_type->size; }
+  std::string_view name(std::size_t slot) const {
+    return m_type->fields[slot].name;
+  }
+  std::size_t slot(std::string_view name) const {
+    for (std::size_t i = 0; i < m_type->size; ++i)
+      if (m_type->fields[i].name == name)
+        return i;
+    return npos;
+  }
+  N field(std::size_t slot) const { return m_type->fields[slot].get(m_self); }
+
+  // items of containers
+  bool empty() const { return sequence() && m_type->empty(m_self); }
+  template<class F>
+  void each(const F& visit) const {
+    m_type->each(m_self, const_cast<F*>(&visit),
+        [](void* visitor, const N& item) {
+          (*static_cast<const F*>(visitor))(item);
+        });
+  }
+
+ private:
+  const void* m_self;
+  const binding_type_t<N>* m_type;
 };
 
 }
@@ -95,24 +496,424 @@ class lambda_t {
 class node;
 using object = internal::object_t<node>;
 using lambda = internal::lambda_t<node>;
-using map = std::map<const std::string, node>;
+using map = std::map<const std::string, node, std::less<>>;
+using flat_map = internal::flat_map_t<node>;
 using array = std::vector<node>;
+using arena_array = internal::arena_array_t<node>;
+using arena_map = internal::arena_map_t<node>;
+using bound = internal::bound_t<node>;
+using binding_field = internal::binding_field_t<node>;
 
 class node : public std::variant<
-    std::nullptr_t, std::string, int, double, bool,
+    std::nullptr_t, std::string, int, std::int64_t, std::uint64_t, double, bool,
     lambda,
     std::shared_ptr<object>,
     map,
-    array> {
+    array,
+    flat_map,
+    string_view_node,
+    arena_array,
+    arena_map,
+    bound> {
 public:
   using std::variant<
-      std::nullptr_t, std::string, int, double, bool,
+      std::nullptr_t, std::string, int, std::int64_t, std::uint64_t, double, bool,
       lambda,
       std::shared_ptr<object>,
       map,
-      array>::variant;
+      array,
+      flat_map,
+      string_view_node,
+      arena_array,
+      arena_map,
+      bound>::variant;
+};
+
+class render_context;
+class instruction;
+namespace internal { class static_context; }
+
+// The compiled body of the section a lambda is called for. It renders the body
+// without parsing it again, as often as needed, either against the current
+// context or with another node pushed onto it. Only valid during the call of
+// the lambda it is passed to.
+class section {
+ public:
+  // the body as it is written in the template
+  std::string_view source() const { return m_source; }
+
+  void render(std::string& out) const;
+  void render(const node& context, std::string& out) const;
+  std::string render() const;
+  std::string render(const node& context) const;
+
+ private:
+  friend class render_node;
+  friend class render_section;
+  friend class internal::static_context;
+  section(
+      render_context& ctx,
+      const instruction* begin,
+      const instruction* end,
+      std::string_view source,
+      std::string_view prefix):
+      m_ctx(ctx), m_begin(begin), m_end(end), m_source(source),
+      m_prefix(prefix)
+  {
+  }
+
+  render_context& m_ctx;
+  const instruction* m_begin;
+  const instruction* m_end;
+  std::string_view m_source;
+  std::string_view m_prefix;
+};
+
+// Binds C++ structs so templates read their fields directly, without copying
+// them into maps first. Specialize binding for a struct with an array of its
+// fields, or use MSTCH_BIND:
+//
+//   MSTCH_BIND(user, MSTCH_FIELD(name), MSTCH_FIELD(orders))
+//
+// mstch::bind(value) then returns a node that only points to value. Strings
+// are bound as views, numbers and bools by value, bound structs and
+// containers of bindable items (vectors, lists, ...) by reference, so value
+// has to outlive the render.
+template<class T>
+struct binding;
+
+template<class T>
+node bind(const T& value);
+
+namespace internal {
+
+template<class T, class = void>
+struct has_binding: std::false_type {};
+
+template<class T>
+struct has_binding<T, std::void_t<decltype(binding<T>::fields)>>:
+    std::true_type {};
+
+template<class T, class = void>
+struct is_container: std::false_type {};
+
+template<class T>
+struct is_container<T, std::void_t<
+    decltype(std::declval<const T&>().begin()),
+    decltype(std::declval<const T&>().end())>>: std::true_type {};
+
+template<class T>
+struct member_class;
+
+template<class C, class M>
+struct member_class<M C::*> {
+  using type = C;
+};
+
+template<class C, class M>
+struct member_class<M (C::*)() const> {
+  using type = C;
+};
+
+// noexcept is part of the function type, getters declared with it need their
+// own specialization
+template<class C, class M>
+struct member_class<M (C::*)() const noexcept> {
+  using type = C;
+};
+
+template<auto Member>
+node get_field(const void* self) {
+  using C = typename member_class<decltype(Member)>::type;
+  auto& object = *static_cast<const C*>(self);
+  if constexpr (std::is_member_function_pointer_v<decltype(Member)>) {
+    using R = decltype((object.*Member)());
+    static_assert(std::is_reference_v<R> || std::is_arithmetic_v<R> ||
+        std::is_convertible_v<R, std::string>,
+        "mstch: bound methods have to return a reference, a number or a string");
+    if constexpr (std::is_reference_v<R> || std::is_arithmetic_v<R>)
+      return mstch::bind((object.*Member)());
+    else
+      return std::string((object.*Member)());
+  } else {
+    return mstch::bind(object.*Member);
+  }
+}
+
+template<class T>
+inline const binding_type_t<node> struct_binding{
+    binding<T>::fields,
+    sizeof(binding<T>::fields) / sizeof(binding<T>::fields[0]),
+    nullptr, nullptr};
+
+template<class C>
+inline const binding_type_t<node> container_binding{
+    nullptr, 0,
+    [](const void* self) {
+      auto& items = *static_cast<const C*>(self);
+      return items.begin() == items.end();
+    },
+    [](const void* self, void* visitor,
+        void (*visit)(void* visitor, const node& item)) {
+      for (auto& item: *static_cast<const C*>(self))
+        visit(visitor, mstch::bind(item));
+    }};
+
+}
+
+// A field named name, read from a data member or a const member function
+template<auto Member>
+constexpr binding_field field(std::string_view name) {
+  return {name, &internal::get_field<Member>};
+}
+
+template<class T>
+node bind(const T& value) {
+  if constexpr (std::is_same_v<T, node>) {
+    return value;
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return value;
+  } else if constexpr (std::is_integral_v<T>) {
+    if constexpr (sizeof(T) < sizeof(int) ||
+        (std::is_signed_v<T> && sizeof(T) == sizeof(int)))
+      return static_cast<int>(value);
+    else if constexpr (std::is_signed_v<T>)
+      return static_cast<std::int64_t>(value);
+    else
+      return static_cast<std::uint64_t>(value);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return static_cast<double>(value);
+  } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    std::string_view view = value;
+    return string_view_node{view.data(), view.size()};
+  } else if constexpr (internal::has_binding<T>::value) {
+    return bound{&value, internal::struct_binding<T>};
+  } else if constexpr (internal::is_container<T>::value) {
+    return bound{&value, internal::container_binding<T>};
+  } else {
+    static_assert(internal::is_container<T>::value,
+        "mstch: no binding for this type, specialize mstch::binding");
+    return nullptr;
+  }
+}
+
+#define MSTCH_BIND(type_name, ...) \
+  template<> \
+  struct mstch::binding<type_name> { \
+    using type = type_name; \
+    static constexpr mstch::binding_field fields[] = {__VA_ARGS__}; \
+  };
+
+#define MSTCH_FIELD(member) mstch::field<&type::member>(#member)
+
+// Builds views in large blocks of memory instead of allocating every string,
+// map and array of them on its own. Strings, arrays and maps stored in the
+// arena are copied into it as string_view_node, arena_array and arena_map,
+// which only point into the arena and need no destruction. The whole arena is
+// released at once when it is destroyed, so no node built in it may be used
+// after that. Lambdas and objects are kept as they are and destroyed with the
+// arena.
+class arena {
+ public:
+  explicit arena(std::size_t block_size = 64 * 1024);
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+  ~arena();
+
+  node string(std::string_view value);
+  node array(std::initializer_list<node> items);
+  node map(std::initializer_list<std::pair<std::string_view, node>> items);
+
+  // make_item(i) returns the node of item i
+  template<class F>
+  node array(std::size_t size, F make_item);
+
+  // make_entry(i) returns the key and node of entry i
+  template<class F>
+  node map(std::size_t size, F make_entry);
+
+  // copy of value with all strings, arrays and maps in it moved to the arena
+  node copy(const node& value);
+
+ private:
+  struct block;
+  void* allocate(std::size_t size, std::size_t alignment);
+  std::string_view store(std::string_view value);
+  void track(node* slot);
+  // sorts the entries and tracks the nodes in them
+  node sorted_map(arena_map::value_type* entries, std::size_t size);
+  std::size_t m_block_size;
+  block* m_blocks;
+  char* m_next;
+  std::size_t m_left;
+  std::vector<node*> m_owned;
+};
+
+template<class F>
+node arena::array(std::size_t size, F make_item) {
+  auto items = static_cast<node*>(allocate(sizeof(node) * size, alignof(node)));
+  for (std::size_t i = 0; i < size; ++i)
+    track(::new (static_cast<void*>(items + i)) node(copy(make_item(i))));
+  return arena_array{items, size};
+}
+
+template<class F>
+node arena::map(std::size_t size, F make_entry) {
+  using entry = arena_map::value_type;
+  auto entries = static_cast<entry*>(
+      allocate(sizeof(entry) * size, alignof(entry)));
+  for (std::size_t i = 0; i < size; ++i) {
+    auto item = make_entry(i);
+    ::new (static_cast<void*>(entries + i))
+        entry(store(item.first), copy(item.second));
+  }
+  return sorted_map(entries, size);
+}
+
+using chunk_sink = std::function<void(const char* data, std::size_t size)>;
+using batch_sink =
+    std::function<void(std::size_t index, const char* data, std::size_t size)>;
+
+class template_type;
+class partial_store;
+class file_store;
+
+class partial_registry {
+ public:
+  partial_registry();
+  partial_registry(const std::map<std::string,std::string>& partials);
+  partial_registry(
+      std::initializer_list<std::pair<const std::string, std::string>> partials);
+
+ private:
+  friend class compiled_template;
+  friend class internal::static_context;
+  std::shared_ptr<const partial_store> m_partials;
 };
 
+// fixed set of worker threads running submitted tasks in order, threads = 0
+// starts one per hardware thread
+class thread_pool {
+ public:
+  explicit thread_pool(std::size_t threads = 0);
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+  ~thread_pool();
+  std::size_t size() const;
+  void submit(std::function<void()> task);
+
+ private:
+  struct state;
+  std::unique_ptr<state> m_state;
+};
+
+// How many name lookups of a compiled template were answered by the inline
+// cache of their tag, and how many had to search the context. Only names
+// found in a scope with positions are counted, std::map lookups are not.
+struct lookup_stats {
+  std::uint64_t hits;
+  std::uint64_t misses;
+};
+
+struct lookup_counters;
+
+class compiled_template {
+ public:
+  compiled_template(
+      const std::string& tmplt,
+      const partial_registry& partials = partial_registry(),
+      const escape_function& escape = config::escape);
+
+  // copy that renders sections over arrays of at least threshold items in
+  // chunks on pool, the output is the same as rendering them in order
+  compiled_template parallel(
+      thread_pool& pool, std::size_t threshold = 10000) const;
+
+  // counted over all renders of this template and of its copies
+  lookup_stats lookups() const;
+
+ private:
+  friend class template_loader;
+  compiled_template(
+      std::shared_ptr<const template_type> tmplt,
+      std::shared_ptr<const partial_store> partials,
+      const escape_function& escape);
+  friend void render(
+      const compiled_template& tmplt, const node& root, std::string& out);
+  friend void render(
+      const compiled_template& tmplt, const node& root, const chunk_sink& sink);
+  friend std::vector<std::string> render_batch(
+      const compiled_template& tmplt,
+      const node* roots,
+      std::size_t count,
+      thread_pool& pool);
+  friend void render_batch(
+      const compiled_template& tmplt,
+      const node* roots,
+      std::size_t count,
+      thread_pool& pool,
+      const batch_sink& sink);
+  std::shared_ptr<const template_type> m_template;
+  std::shared_ptr<const partial_store> m_partials;
+  escape_function m_escape;
+  thread_pool* m_pool = nullptr;
+  std::size_t m_parallel_threshold = 0;
+  std::shared_ptr<lookup_counters> m_lookups;
+};
+
+class template_loader {
+ public:
+  template_loader(
+      const std::string& directory,
+      const escape_function& escape = config::escape);
+  template_loader(const template_loader&) = delete;
+  template_loader& operator=(const template_loader&) = delete;
+  compiled_template get(const std::string& name) const;
+
+ private:
+  escape_function m_escape;
+  mutable std::mutex m_mutex;
+  mutable std::shared_ptr<const file_store> m_files;
+};
+
+std::string render(const compiled_template& tmplt, const node& root);
+
+void render(const compiled_template& tmplt, const node& root, std::string& out);
+
+void render(const compiled_template& tmplt, const node& root, std::ostream& out);
+
+void render(
+    const compiled_template& tmplt, const node& root, const chunk_sink& sink);
+
+// Render tmplt once for each of count roots, spread over the threads of pool
+// and the calling thread. Every thread reuses one render state for all the
+// roots it renders.
+std::vector<std::string> render_batch(
+    const compiled_template& tmplt,
+    const node* roots,
+    std::size_t count,
+    thread_pool& pool);
+
+std::vector<std::string> render_batch(
+    const compiled_template& tmplt,
+    const std::vector<node>& roots,
+    thread_pool& pool);
+
+// threads = 0 uses one thread per core
+std::vector<std::string> render_batch(
+    const compiled_template& tmplt,
+    const std::vector<node>& roots,
+    std::size_t threads = 0);
+
+// hands each output to sink together with the index of its root instead, sink
+// is called from several threads at once, each thread reuses one buffer
+void render_batch(
+    const compiled_template& tmplt,
+    const node* roots,
+    std::size_t count,
+    thread_pool& pool,
+    const batch_sink& sink);
+
 std::string render(
     const std::string& tmplt,
     const node& root,
@@ -0,0 +1,488 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "mstch/mstch.hpp"
+
+namespace mstch {
+
+namespace internal {
+
+class static_context;
+
+// A section of a static template as the runtime part sees it: render renders
+// the body, text appends the body as section lambdas get it, with prefix
+// after every line.
+struct static_section {
+  void (*render)(static_context& context);
+  void (*text)(std::string& out, std::string_view prefix);
+  std::string_view source;
+  std::string_view open;
+  std::string_view close;
+};
+
+// Looks names up and renders values for static templates and for the
+// render functions mstch_codegen generates, the same way the interpreter
+// does.
+class static_context {
+ public:
+  static_context(const node& root, std::string& out);
+  // partials are used by partial tags compiled at run time, in the bodies of
+  // section lambdas and in the text lambdas return
+  static_context(
+      const node& root, std::string& out, const partial_registry& partials);
+  static_context(const static_context&) = delete;
+  static_context& operator=(const static_context&) = delete;
+  ~static_context();
+
+  void text(std::string_view text) {
+    m_out.append(text.data(), text.size());
+  }
+  // the indentation of the partial being rendered, at the start of a line
+  void prefix() {
+    if (!m_prefix.empty())
+      m_out.append(m_prefix.data(), m_prefix.size());
+  }
+  void partial(void (*render)(static_context& context), std::string_view prefix) {
+    auto outer = m_prefix;
+    m_prefix = prefix;
+    render(*this);
+    m_prefix = outer;
+  }
+  void variable(const std::string_view* path, std::size_t size, bool escape);
+  void section(
+      const std::string_view* path, std::size_t size,
+      const static_section& body);
+  void inverted_section(
+      const std::string_view* path, std::size_t size,
+      const static_section& body);
+
+ private:
+  static_context(
+      const node& root, std::string& out, const partial_store& partials);
+  void section_item(const node& item, const static_section& body);
+  void lambda_section(const lambda& fun, const static_section& body);
+  std::unique_ptr<render_context> m_context;
+  std::string& m_out;
+  std::string_view m_prefix;
+};
+
+// The parser below follows template_type, including the whitespace handling
+// of standalone tags, but runs at compile time. Templates that the
+// interpreter would render only up to the point where they go wrong are
+// rejected instead.
+
+constexpr std::size_t static_npos = static_cast<std::size_t>(-1);
+
+inline void static_error(const char*) {}
+
+enum class static_type: unsigned char {
+  text, variable, section_open, section_close, inverted_section_open,
+  unescaped_variable, comment, partial, delimiter_change
+};
+
+struct static_token {
+  static_type type = static_type::text;
+  std::string_view raw;
+  std::string_view name;
+  std::size_t left = 0;
+  std::size_t right = 0;
+  bool eol = false;
+  bool ws_only = false;
+  std::size_t end = 0;
+  std::size_t parent = static_npos;
+  std::size_t path = 0;
+  std::size_t path_size = 0;
+};
+
+template<std::size_t N>
+struct static_parse {
+  std::array<static_token, N> tokens{};
+  std::size_t size = 0;
+  std::array<std::string_view, N> paths{};
+  std::size_t path_count = 0;
+};
+
+constexpr std::size_t static_length(const char* source) {
+  std::size_t size = 0;
+  while (source[size] != '\0')
+    ++size;
+  return size;
+}
+
+constexpr std::size_t static_first_not_ws(
+    std::string_view str, std::size_t begin, std::size_t end)
+{
+  for (auto i = begin; i < end; ++i)
+    if (str[i] != ' ')
+      return i;
+  return end;
+}
+
+// one past the last non space before end, begin if there is none
+constexpr std::size_t static_last_not_ws(
+    std::string_view str, std::size_t begin, std::size_t end)
+{
+  for (auto i = end; i > begin; --i)
+    if (str[i - 1] != ' ')
+      return i;
+  return begin;
+}
+
+constexpr std::string_view static_view(
+    std::string_view str, std::size_t begin, std::size_t end)
+{
+  return end < begin ? str.substr(begin, 0) : str.substr(begin, end - begin);
+}
+
+constexpr static_type static_token_info(char c) {
+  switch (c) {
+    case '>': return static_type::partial;
+    case '^': return static_type::inverted_section_open;
+    case '/': return static_type::section_close;
+    case '&': return static_type::unescaped_variable;
+    case '#': return static_type::section_open;
+    case '!': return static_type::comment;
+    default: return static_type::variable;
+  }
+}
+
+constexpr static_token static_text(std::string_view str) {
+  static_token token;
+  token.raw = str;
+  token.eol = str.size() > 0 && str[str.size() - 1] == '\n';
+  token.ws_only = true;
+  for (auto c: str)
+    if (c != ' ' && c != '\r' && c != '\n' && c != '\t')
+      token.ws_only = false;
+  return token;
+}
+
+constexpr static_token static_tag(
+    std::string_view str, std::size_t left, std::size_t right)
+{
+  static_token token;
+  token.raw = str;
+  if (str[left] == '=' && str[str.size() - right - 1] == '=') {
+    token.type = static_type::delimiter_change;
+  } else if (str[left] == '{' && str[str.size() - right - 1] == '}') {
+    token.type = static_type::unescaped_variable;
+    token.name = static_view(str,
+        static_first_not_ws(str, left + 1, str.size() - right),
+        static_last_not_ws(str, left, str.size() - right - 1));
+  } else {
+    auto c = static_first_not_ws(str, left, str.size() - right);
+    if (c == str.size() - right)
+      static_error("mstch: empty tag");
+    token.type = static_token_info(str[c]);
+    if (token.type != static_type::variable)
+      c = static_first_not_ws(str, c + 1, str.size() - right);
+    token.name = static_view(
+        str, c, static_last_not_ws(str, left, str.size() - right));
+    token.left = left;
+    token.right = right;
+  }
+  return token;
+}
+
+template<std::size_t N>
+constexpr void static_push(static_parse<N>& parse, const static_token& token) {
+  parse.tokens[parse.size++] = token;
+}
+
+template<std::size_t N>
+constexpr void static_process_text(static_parse<N>& parse, std::string_view text) {
+  std::size_t start = 0;
+  for (std::size_t pos = 0; pos < text.size(); ++pos)
+    if (text[pos] == '\n' || pos == text.size() - 1) {
+      static_push(parse, static_text(text.substr(start, pos + 1 - start)));
+      start = pos + 1;
+    }
+}
+
+template<std::size_t N>
+constexpr void static_tokenize(static_parse<N>& parse, std::string_view tmp) {
+  std::string_view open{"{{"};
+  std::string_view close{"}}"};
+  auto char_at = [&tmp](std::size_t pos) {
+    return pos < tmp.size() ? tmp[pos] : '\0';
+  };
+
+  std::size_t text_pos = 0;
+  for (std::size_t cur_pos = 0; cur_pos < tmp.size();) {
+    auto open_pos = cur_pos;
+    while (open_pos < tmp.size() && tmp[open_pos] != '\n' &&
+        tmp[open_pos] != open[0])
+      ++open_pos;
+    if (open_pos == tmp.size())
+      break;
+    if (tmp.compare(open_pos, open.size(), open) != 0) {
+      if (tmp[open_pos] == '\n') {
+        static_push(parse,
+            static_text(tmp.substr(text_pos, open_pos + 1 - text_pos)));
+        text_pos = open_pos + 1;
+      }
+      cur_pos = open_pos + 1;
+      continue;
+    }
+
+    auto close_pos = tmp.find(close, open_pos + 1);
+    if (close_pos == std::string_view::npos)
+      static_error("mstch: tag without closing delimiter");
+    if (char_at(open_pos + open.size()) == '{' &&
+        char_at(close_pos + close.size()) == '}')
+      ++close_pos;
+
+    if (open_pos != text_pos)
+      static_push(parse, static_text(tmp.substr(text_pos, open_pos - text_pos)));
+    cur_pos = text_pos = close_pos + close.size();
+    static_push(parse, static_tag(
+        tmp.substr(open_pos, cur_pos - open_pos), open.size(), close.size()));
+
+    if (cur_pos == tmp.size()) {
+      auto end = static_text(tmp.substr(cur_pos));
+      end.eol = true;
+      static_push(parse, end);
+    }
+
+    if (char_at(open_pos + open.size()) == '=' &&
+        char_at(close_pos - 1) == '=')
+    {
+      auto front = static_first_not_ws(tmp, open_pos + open.size() + 1,
+          close_pos - 1);
+      auto back = static_last_not_ws(tmp, open_pos + open.size() + 1,
+          close_pos - 1) - 1;
+      auto open_end = tmp.find(' ', front);
+      auto close_begin = tmp.rfind(' ', back);
+      if (open_end == std::string_view::npos || open_end > back ||
+          close_begin == std::string_view::npos || close_begin < front)
+        static_error("mstch: malformed delimiter change");
+      open = tmp.substr(front, open_end - front);
+      close = tmp.substr(close_begin + 1, back - close_begin);
+    }
+  }
+  static_process_text(parse, tmp.substr(text_pos));
+}
+
+template<std::size_t N>
+constexpr void static_strip_whitespace(static_parse<N>& parse) {
+  std::size_t kept = 0, line_begin = 0;
+  bool has_tag = false, non_space = false;
+
+  for (std::size_t i = 0; i < parse.size; ++i) {
+    auto& token = parse.tokens[i];
+    if (token.type != static_type::text &&
+        token.type != static_type::variable &&
+        token.type != static_type::unescaped_variable)
+      has_tag = true;
+    else if (!token.ws_only)
+      non_space = true;
+
+    if (token.eol) {
+      bool standalone = has_tag && !non_space;
+      for (auto c = line_begin; c != i + 1; ++c)
+        if (!standalone || !parse.tokens[c].ws_only)
+          parse.tokens[kept++] = parse.tokens[c];
+      non_space = has_tag = false;
+      line_begin = i + 1;
+    }
+  }
+  for (auto c = line_begin; c != parse.size; ++c)
+    parse.tokens[kept++] = parse.tokens[c];
+  parse.size = kept;
+}
+
+template<std::size_t N>
+constexpr void static_link_sections(static_parse<N>& parse) {
+  std::array<std::size_t, N> open{};
+  std::size_t depth = 0;
+  for (std::size_t i = 0; i < parse.size; ++i) {
+    auto& token = parse.tokens[i];
+    token.parent = depth == 0 ? static_npos : open[depth - 1];
+    if (token.type == static_type::partial)
+      static_error("mstch: static templates can't have partials");
+    if (token.type == static_type::section_open ||
+        token.type == static_type::inverted_section_open) {
+      open[depth++] = i;
+    } else if (token.type == static_type::section_close) {
+      if (depth == 0 || parse.tokens[open[depth - 1]].name != token.name)
+        static_error("mstch: section end without matching section");
+      parse.tokens[open[--depth]].end = i;
+    }
+  }
+  if (depth != 0)
+    static_error("mstch: section without end");
+}
+
+template<std::size_t N>
+constexpr void static_split_paths(static_parse<N>& parse) {
+  for (std::size_t i = 0; i < parse.size; ++i) {
+    auto& token = parse.tokens[i];
+    if (token.type == static_type::text)
+      continue;
+    token.path = parse.path_count;
+    auto name = token.name;
+    if (name == ".") {
+      parse.paths[parse.path_count++] = name;
+    } else {
+      std::size_t start = 0;
+      for (std::size_t pos = 0; pos <= name.size(); ++pos)
+        if (pos == name.size() || name[pos] == '.') {
+          parse.paths[parse.path_count++] = name.substr(start, pos - start);
+          start = pos + 1;
+        }
+    }
+    token.path_size = parse.path_count - token.path;
+  }
+}
+
+template<std::size_t N>
+constexpr static_parse<N> static_compile(std::string_view source) {
+  static_parse<N> parse;
+  static_tokenize(parse, source);
+  static_strip_whitespace(parse);
+  static_link_sections(parse);
+  static_split_paths(parse);
+  return parse;
+}
+
+template<std::size_t Offset, std::size_t... I>
+constexpr std::index_sequence<Offset + I...> static_offset(
+    std::index_sequence<I...>)
+{
+  return {};
+}
+
+}
+
+// A template given as a character array with static storage duration, parsed
+// at compile time. Rendering it is a sequence of appends of its text and
+// lookups of its tags, errors in the template are compile errors:
+//
+//   static constexpr char greeting[] = "Hello {{name}}!";
+//   mstch::static_template<greeting> tmplt;
+//   std::string out = mstch::render(tmplt, view);
+//
+// Partials are not supported.
+template<const char* Source>
+class static_template {
+ public:
+  static void render(const node& root, std::string& out) {
+    internal::static_context context{root, out};
+    render_children<internal::static_npos>(
+        context, std::make_index_sequence<parsed.size>());
+  }
+
+ private:
+  using type = internal::static_type;
+  static constexpr std::string_view source{
+      Source, internal::static_length(Source)};
+  static constexpr auto parsed =
+      internal::static_compile<source.size() + 2>(source);
+
+  template<std::size_t I>
+  static constexpr std::array<std::string_view, parsed.tokens[I].path_size>
+  make_path() {
+    std::array<std::string_view, parsed.tokens[I].path_size> path{};
+    for (std::size_t i = 0; i < path.size(); ++i)
+      path[i] = parsed.paths[parsed.tokens[I].path + i];
+    return path;
+  }
+
+  template<std::size_t I>
+  static constexpr auto path = make_path<I>();
+
+  template<std::size_t I>
+  static constexpr std::string_view section_source() {
+    constexpr auto end = parsed.tokens[I].end;
+    if constexpr (end == I + 1) {
+      return {};
+    } else {
+      constexpr auto& first = parsed.tokens[I + 1];
+      constexpr auto& last = parsed.tokens[end - 1];
+      return {first.raw.data(), static_cast<std::size_t>(
+          last.raw.data() + last.raw.size() - first.raw.data())};
+    }
+  }
+
+  template<std::size_t I>
+  static void render_body(internal::static_context& context) {
+    render_children<I>(context, internal::static_offset<I + 1>(
+        std::make_index_sequence<parsed.tokens[I].end - I - 1>()));
+  }
+
+  template<std::size_t J>
+  static void append_token(std::string& out, std::string_view prefix) {
+    out.append(parsed.tokens[J].raw.data(), parsed.tokens[J].raw.size());
+    if constexpr (parsed.tokens[J].eol)
+      out.append(prefix.data(), prefix.size());
+  }
+
+  template<std::size_t... J>
+  static void append_tokens(
+      std::string& out, std::string_view prefix, std::index_sequence<J...>)
+  {
+    (append_token<J>(out, prefix), ...);
+  }
+
+  template<std::size_t I>
+  static void section_text(std::string& out, std::string_view prefix) {
+    append_tokens(out, prefix, internal::static_offset<I + 1>(
+        std::make_index_sequence<parsed.tokens[I].end - I - 1>()));
+  }
+
+  template<std::size_t I>
+  static constexpr internal::static_section section = {
+      &render_body<I>,
+      &section_text<I>,
+      section_source<I>(),
+      parsed.tokens[I].raw.substr(0, parsed.tokens[I].left),
+      parsed.tokens[I].raw.substr(
+          parsed.tokens[I].raw.size() - parsed.tokens[I].right)};
+
+  template<std::size_t Parent, std::size_t... I>
+  static void render_children(
+      internal::static_context& context, std::index_sequence<I...>)
+  {
+    (render_child<Parent, I>(context), ...);
+  }
+
+  template<std::size_t Parent, std::size_t I>
+  static void render_child(internal::static_context& context) {
+    constexpr auto& token = parsed.tokens[I];
+    if constexpr (token.parent != Parent) {
+      return;
+    } else if constexpr (token.type == type::text) {
+      context.text(token.raw);
+    } else if constexpr (token.type == type::variable ||
+        token.type == type::unescaped_variable) {
+      context.variable(path<I>.data(), path<I>.size(),
+          token.type == type::variable);
+    } else if constexpr (token.type == type::section_open) {
+      context.section(path<I>.data(), path<I>.size(), section<I>);
+    } else if constexpr (token.type == type::inverted_section_open) {
+      context.inverted_section(path<I>.data(), path<I>.size(), section<I>);
+    }
+  }
+};
+
+template<const char* Source>
+void render(
+    const static_template<Source>&, const node& root, std::string& out)
+{
+  static_template<Source>::render(root, out);
+}
+
+template<const char* Source>
+std::string render(const static_template<Source>& tmplt, const node& root) {
+  std::string out;
+  render(tmplt, root, out);
+  return out;
+}
+
+}
@@ -0,0 +1,68 @@
+# Build rules for generating C++ render functions from mustache templates.
+
+_cpp17_flags = select({
+    "@platforms//os:windows": ["/std:c++17", "/EHsc"],
+    "//conditions:default": ["-std=c++17"],
+})
+
+def mstch_cc_template(
+        name,
+        srcs,
+        partials = {},
+        namespace = "",
+        deps = [],
+        **kwargs):
+    """Compiles mustache templates into a cc_library at build time.
+
+    mstch_codegen parses every template in srcs and emits one function per
+    template, `void render_<stem>(const mstch::node&, std::string&)` and a
+    version returning the string, declared in `<package>/<name>.hpp`.
+
+    Args:
+      name: name of the cc_library, and of the generated header and source.
+      srcs: template files, each becomes a render function named after it.
+        Their stems, the file names up to the first '.', must differ.
+      partials: dict from partial name to template file. Partial tags call
+        the partial's code directly, partials not in here render nothing.
+      namespace: C++ namespace of the render functions.
+      deps: additional dependencies of the cc_library.
+      **kwargs: passed to the cc_library, e.g. visibility.
+    """
+    header = name + ".hpp"
+    source = name + ".cpp"
+    package = native.package_name()
+    include = package + "/" + header if package else header
+    codegen = str(Label("//:mstch_codegen"))
+
+    args = [
+        "--header $(location %s)" % header,
+        "--source $(location %s)" % source,
+        "--include " + include,
+    ]
+    if namespace:
+        args.append("--namespace " + namespace)
+    for partial, file in partials.items():
+        args.append("--partial %s=$(location %s)" % (partial, file))
+    args += ["$(location %s)" % file for file in srcs]
+
+    files = []
+    for file in srcs + partials.values():
+        if file not in files:
+            files.append(file)
+
+    native.genrule(
+        name = name + "_codegen",
+        srcs = files,
+        outs = [header, source],
+        cmd = "$(location %s) %s" % (codegen, " ".join(args)),
+        tools = [codegen],
+    )
+
+    native.cc_library(
+        name = name,
+        srcs = [source],
+        hdrs = [header],
+        copts = _cpp17_flags,
+        deps = [str(Label("//:mstch"))] + deps,
+        **kwargs
+    )
@@ -0,0 +1,110 @@
+#include "mstch/mstch.hpp"
+
+#include <cstring>
+#include <new>
+
+using namespace mstch;
+
+struct mstch::arena::block {
+  block* next;
+};
+
+mstch::arena::arena(std::size_t block_size):
+    m_block_size(block_size), m_blocks(nullptr), m_next(nullptr), m_left(0)
+{
+}
+
+mstch::arena::~arena() {
+  for (auto owned: m_owned)
+    owned->~node();
+  while (m_blocks) {
+    auto next = m_blocks->next;
+    ::operator delete(m_blocks);
+    m_blocks = next;
+  }
+}
+
+void* mstch::arena::allocate(std::size_t size, std::size_t alignment) {
+  auto padding = (alignment - reinterpret_cast<std::uintptr_t>(m_next) % alignment)
+      % alignment;
+  if (m_left < size + padding) {
+    auto block_size = std::max(m_block_size, sizeof(block) + size + alignment);
+    auto added = static_cast<block*>(::operator new(block_size));
+    added->next = m_blocks;
+    m_blocks = added;
+    m_next = reinterpret_cast<char*>(added + 1);
+    m_left = block_size - sizeof(block);
+    padding = (alignment - reinterpret_cast<std::uintptr_t>(m_next) % alignment)
+        % alignment;
+  }
+  auto result = m_next + padding;
+  m_next = result + size;
+  m_left -= size + padding;
+  return result;
+}
+
+std::string_view mstch::arena::store(std::string_view value) {
+  if (value.empty())
+    return {};
+  auto data = static_cast<char*>(allocate(value.size(), 1));
+  std::memcpy(data, value.data(), value.size());
+  return {data, value.size()};
+}
+
+void mstch::arena::track(node* slot) {
+  if (std::holds_alternative<lambda>(*slot) ||
+      std::holds_alternative<std::shared_ptr<object>>(*slot))
+    m_owned.push_back(slot);
+}
+
+node mstch::arena::sorted_map(arena_map::value_type* entries, std::size_t size) {
+  std::stable_sort(entries, entries + size,
+      [](const arena_map::value_type& a, const arena_map::value_type& b) {
+        return a.first < b.first;
+      });
+  for (std::size_t i = 0; i < size; ++i)
+    track(&entries[i].second);
+  return arena_map{entries, size};
+}
+
+node mstch::arena::string(std::string_view value) {
+  auto stored = store(value);
+  return string_view_node{stored.data(), stored.size()};
+}
+
+node mstch::arena::array(std::initializer_list<node> items) {
+  return array(items.size(), [&items](std::size_t i) -> const node& {
+    return items.begin()[i];
+  });
+}
+
+node mstch::arena::map(
+    std::initializer_list<std::pair<std::string_view, node>> items)
+{
+  return map(items.size(),
+      [&items](std::size_t i) -> const std::pair<std::string_view, node>& {
+        return items.begin()[i];
+      });
+}
+
+node mstch::arena::copy(const node& value) {
+  return std::visit([this](const auto& item) -> node {
+    using T = std::decay_t<decltype(item)>;
+    if constexpr (std::is_same_v<T, std::string>) {
+      return string(item);
+    } else if constexpr (std::is_same_v<T, mstch::array>) {
+      return array(item.size(), [&item](std::size_t i) -> const node& {
+        return item[i];
+      });
+    } else if constexpr (std::is_same_v<T, mstch::map> ||
+        std::is_same_v<T, flat_map>) {
+      auto it = item.begin();
+      return map(item.size(), [&it](std::size_t) {
+        auto& entry = *it++;
+        return std::pair<std::string_view, const node&>{entry.first, entry.second};
+      });
+    } else {
+      return item;
+    }
+  }, value);
+}
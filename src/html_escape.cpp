@@ -0,0 +1,115 @@
+#include "utils.hpp"
+#include "simd.hpp"
+
+using namespace mstch;
+
+namespace {
+
+using escape_kernel = void (*)(const char*, const char*, std::string&);
+
+const char* escaped(char c) {
+  switch (c) {
+    case '&': return "&amp;";
+    case '\'': return "&#39;";
+    case '"': return "&quot;";
+    case '<': return "&lt;";
+    case '>': return "&gt;";
+    case '/': return "&#x2F;";
+    default: return nullptr;
+  }
+}
+
+void escape_scalar(const char* begin, const char* end, std::string& out) {
+  auto start = begin;
+  for (auto it = begin; it != end; ++it)
+    if (auto escape = escaped(*it)) {
+      out.append(start, it);
+      out += escape;
+      start = it + 1;
+    }
+  out.append(start, end);
+}
+
+#ifdef MSTCH_X86_64
+
+// appends the escapes for every set bit of mask, a bit per byte of the
+// block starting at it, and the unescaped text in between
+void escape_block(
+    const char* it, unsigned int mask, const char*& start, std::string& out)
+{
+  while (mask != 0) {
+    auto pos = it + first_bit(mask);
+    out.append(start, pos);
+    out += escaped(*pos);
+    start = pos + 1;
+    mask &= mask - 1;
+  }
+}
+
+void escape_sse2(const char* begin, const char* end, std::string& out) {
+  const __m128i amp = _mm_set1_epi8('&');
+  const __m128i apos = _mm_set1_epi8('\'');
+  const __m128i quot = _mm_set1_epi8('"');
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>');
+  const __m128i slash = _mm_set1_epi8('/');
+
+  auto start = begin;
+  auto it = begin;
+  for (; end - it >= 16; it += 16) {
+    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    auto hits = _mm_or_si128(
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, amp), _mm_cmpeq_epi8(block, apos)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, quot), _mm_cmpeq_epi8(block, lt))),
+        _mm_or_si128(_mm_cmpeq_epi8(block, gt), _mm_cmpeq_epi8(block, slash)));
+    escape_block(it, static_cast<unsigned int>(_mm_movemask_epi8(hits)), start, out);
+  }
+  out.append(start, it);
+  escape_scalar(it, end, out);
+}
+
+MSTCH_TARGET_AVX2
+void escape_avx2(const char* begin, const char* end, std::string& out) {
+  const __m256i amp = _mm256_set1_epi8('&');
+  const __m256i apos = _mm256_set1_epi8('\'');
+  const __m256i quot = _mm256_set1_epi8('"');
+  const __m256i lt = _mm256_set1_epi8('<');
+  const __m256i gt = _mm256_set1_epi8('>');
+  const __m256i slash = _mm256_set1_epi8('/');
+
+  auto start = begin;
+  auto it = begin;
+  for (; end - it >= 32; it += 32) {
+    auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+    auto hits = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(block, amp), _mm256_cmpeq_epi8(block, apos)),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(block, quot), _mm256_cmpeq_epi8(block, lt))),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(block, gt), _mm256_cmpeq_epi8(block, slash)));
+    escape_block(
+        it, static_cast<unsigned int>(_mm256_movemask_epi8(hits)), start, out);
+  }
+  out.append(start, it);
+  escape_sse2(it, end, out);
+}
+
+#endif
+
+escape_kernel select_kernel() {
+#ifdef MSTCH_X86_64
+  return has_avx2() ? escape_avx2 : escape_sse2;
+#else
+  return escape_scalar;
+#endif
+}
+
+}
+
+void mstch::html_escape(std::string_view str, std::string& out) {
+  static const escape_kernel kernel = select_kernel();
+  kernel(str.data(), str.data() + str.size(), out);
+}
@@ -0,0 +1,77 @@
+#include "lambda_cache.hpp"
+#include "mstch/mstch.hpp"
+
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+using namespace mstch;
+
+namespace {
+
+// results larger than this are compiled every time rather than cached
+constexpr std::size_t max_text_size = 16 * 1024;
+
+struct entry {
+  std::size_t hash;
+  std::string text;
+  std::string open;
+  std::string close;
+  std::shared_ptr<const template_type> compiled;
+
+  bool matches(std::string_view t, const delim_type& delims) const {
+    return text == t && open == delims.first && close == delims.second;
+  }
+};
+
+struct cache_state {
+  std::list<entry> entries; // most recently used first
+  std::unordered_map<std::size_t, std::list<entry>::iterator> index;
+};
+
+// every thread has its own cache, a hit doesn't synchronize with anything
+cache_state& state() {
+  thread_local cache_state cache;
+  return cache;
+}
+
+std::size_t hash_of(std::string_view text, const delim_type& delims) {
+  std::hash<std::string_view> hash;
+  auto seed = hash(text);
+  seed ^= hash(delims.first) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  seed ^= hash(delims.second) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+}
+
+std::shared_ptr<const template_type> lambda_cache::get(
+    std::string_view text, const delim_type& delims)
+{
+  auto capacity = config::lambda_cache_size.load(std::memory_order_relaxed);
+  if (capacity == 0 || text.size() > max_text_size)
+    return std::make_shared<const template_type>(text, delims);
+
+  auto hash = hash_of(text, delims);
+  auto& cache = state();
+  auto it = cache.index.find(hash);
+  if (it != cache.index.end() && it->second->matches(text, delims)) {
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+    return it->second->compiled;
+  }
+
+  auto compiled = std::make_shared<const template_type>(text, delims);
+  if (it != cache.index.end()) {
+    cache.entries.erase(it->second);
+    cache.index.erase(it);
+  }
+  cache.entries.push_front({hash, std::string{text},
+      std::string{delims.first}, std::string{delims.second}, compiled});
+  cache.index.emplace(hash, cache.entries.begin());
+  while (cache.entries.size() > capacity) {
+    cache.index.erase(cache.entries.back().hash);
+    cache.entries.pop_back();
+  }
+  return compiled;
+}
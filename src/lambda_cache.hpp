@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "template_type.hpp"
+
+namespace mstch {
+
+// Templates compiled from lambda results, keyed by the result text and the
+// delimiters it is parsed with. A lambda called inside a section usually
+// returns the same few strings, those are only tokenized once. Each thread
+// keeps the config::lambda_cache_size templates it used most recently.
+class lambda_cache {
+ public:
+  static std::shared_ptr<const template_type> get(
+      std::string_view text, const delim_type& delims);
+};
+
+}
@@ -1,18 +1,213 @@
 #include "mstch/mstch.hpp"
 #include "render_context.hpp"
+#include "partial_store.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <ostream>
 
 using namespace mstch;
 
-std::function<std::string(const std::string&)> mstch::config::escape;
+mstch::escape_function mstch::config::escape;
+std::atomic<std::size_t> mstch::config::lambda_cache_size{256};
+
+mstch::partial_registry::partial_registry():
+    m_partials(std::make_shared<const partial_store>())
+{
+}
+
+mstch::partial_registry::partial_registry(
+    const std::map<std::string,std::string>& partials):
+    m_partials(std::make_shared<const partial_store>(partials))
+{
+}
+
+mstch::partial_registry::partial_registry(
+    std::initializer_list<std::pair<const std::string, std::string>> partials):
+    partial_registry(std::map<std::string,std::string>(partials))
+{
+}
+
+mstch::compiled_template::compiled_template(
+    const std::string& tmplt,
+    const partial_registry& partials,
+    const escape_function& escape):
+    m_partials(partials.m_partials),
+    m_escape(escape),
+    m_lookups(std::make_shared<lookup_counters>())
+{
+  auto compiled = std::make_shared<template_type>(tmplt);
+  compiled->resolve_partials(*m_partials);
+  m_template = std::move(compiled);
+}
+
+mstch::compiled_template::compiled_template(
+    std::shared_ptr<const template_type> tmplt,
+    std::shared_ptr<const partial_store> partials,
+    const escape_function& escape):
+    m_template(std::move(tmplt)),
+    m_partials(std::move(partials)),
+    m_escape(escape),
+    m_lookups(std::make_shared<lookup_counters>())
+{
+}
+
+mstch::compiled_template mstch::compiled_template::parallel(
+    thread_pool& pool, std::size_t threshold) const
+{
+  auto copy = *this;
+  copy.m_pool = &pool;
+  copy.m_parallel_threshold = threshold;
+  return copy;
+}
+
+mstch::lookup_stats mstch::compiled_template::lookups() const {
+  return {m_lookups->hits.load(), m_lookups->misses.load()};
+}
+
+mstch::template_loader::template_loader(
+    const std::string& directory,
+    const escape_function& escape):
+    m_escape(escape),
+    m_files(std::make_shared<const file_store>(directory))
+{
+}
+
+mstch::compiled_template mstch::template_loader::get(
+    const std::string& name) const
+{
+  std::shared_ptr<const file_store> files;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    files = m_files;
+  }
+  if (!files->is_fresh(name)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_files == files)
+      m_files = files->refresh();
+    files = m_files;
+  }
+  auto partial = files->find(name);
+  if (!partial)
+    throw std::runtime_error("mstch: can't load template " + files->path(name));
+  return compiled_template(
+      std::shared_ptr<const template_type>(files, &partial->get()),
+      files, m_escape);
+}
+
+std::string mstch::render(const compiled_template& tmplt, const node& root) {
+  std::string out;
+  render(tmplt, root, out);
+  return out;
+}
+
+void mstch::render(
+    const compiled_template& tmplt, const node& root, std::string& out)
+{
+  render_context(root, *tmplt.m_partials, tmplt.m_escape,
+      tmplt.m_pool, tmplt.m_parallel_threshold,
+      tmplt.m_lookups).render(*tmplt.m_template, out);
+}
+
+void mstch::render(
+    const compiled_template& tmplt, const node& root, std::ostream& out)
+{
+  render(tmplt, root, [&out](const char* data, std::size_t size) {
+    out.write(data, size);
+  });
+}
+
+void mstch::render(
+    const compiled_template& tmplt, const node& root, const chunk_sink& sink)
+{
+  render_context(root, *tmplt.m_partials, tmplt.m_escape,
+      tmplt.m_pool, tmplt.m_parallel_threshold,
+      tmplt.m_lookups).render(*tmplt.m_template, sink);
+}
+
+namespace {
+
+std::size_t batch_chunks(std::size_t count, const thread_pool& pool) {
+  return std::min(count, 16 * (pool.size() + 1));
+}
+
+}
+
+std::vector<std::string> mstch::render_batch(
+    const compiled_template& tmplt,
+    const node* roots,
+    std::size_t count,
+    thread_pool& pool)
+{
+  std::vector<std::string> outputs(count);
+  if (count == 0)
+    return outputs;
+  auto chunks = batch_chunks(count, pool);
+  parallel_chunks(pool, chunks, [&] {
+    return [&, context = std::make_unique<render_context>(
+        roots[0], *tmplt.m_partials, tmplt.m_escape,
+        tmplt.m_pool, tmplt.m_parallel_threshold,
+        tmplt.m_lookups)](std::size_t chunk) {
+      auto end = count * (chunk + 1) / chunks;
+      for (auto i = count * chunk / chunks; i < end; ++i) {
+        context->reset(roots[i]);
+        context->render(*tmplt.m_template, outputs[i]);
+      }
+      context->flush_lookups();
+    };
+  });
+  return outputs;
+}
+
+std::vector<std::string> mstch::render_batch(
+    const compiled_template& tmplt,
+    const std::vector<node>& roots,
+    thread_pool& pool)
+{
+  return render_batch(tmplt, roots.data(), roots.size(), pool);
+}
+
+std::vector<std::string> mstch::render_batch(
+    const compiled_template& tmplt,
+    const std::vector<node>& roots,
+    std::size_t threads)
+{
+  thread_pool pool(threads);
+  return render_batch(tmplt, roots.data(), roots.size(), pool);
+}
+
+void mstch::render_batch(
+    const compiled_template& tmplt,
+    const node* roots,
+    std::size_t count,
+    thread_pool& pool,
+    const batch_sink& sink)
+{
+  if (count == 0)
+    return;
+  auto chunks = batch_chunks(count, pool);
+  parallel_chunks(pool, chunks, [&] {
+    return [&, context = std::make_unique<render_context>(
+        roots[0], *tmplt.m_partials, tmplt.m_escape,
+        tmplt.m_pool, tmplt.m_parallel_threshold,
+        tmplt.m_lookups),
+        buffer = std::string()](std::size_t chunk) mutable {
+      auto end = count * (chunk + 1) / chunks;
+      for (auto i = count * chunk / chunks; i < end; ++i) {
+        buffer.clear();
+        context->reset(roots[i]);
+        context->render(*tmplt.m_template, buffer);
+        sink(i, buffer.data(), buffer.size());
+      }
+      context->flush_lookups();
+    };
+  });
+}
 
 std::string mstch::render(
     const std::string& tmplt,
     const node& root,
     const std::map<std::string,std::string>& partials)
 {
-  std::map<std::string, template_type> partial_templates;
-  for (auto& partial: partials)
-    partial_templates.insert({partial.first, {partial.second}});
-
-  return render_context(root, partial_templates).render(tmplt);
+  return render(compiled_template(tmplt, partials), root);
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "mstch/mstch.hpp"
+
+namespace mstch {
+
+// Results of object methods memoized with memoize::per_render, kept until the
+// render context is reset or destroyed.
+class object_memo {
+ public:
+  const mstch::node& get(const object& object, std::size_t slot) {
+    key k{&object, slot};
+    auto it = m_index.find(k);
+    if (it != m_index.end())
+      return *it->second;
+    auto& result = m_results.emplace_back(object.invoke(slot));
+    m_index.emplace(k, &result);
+    return result;
+  }
+
+  void clear() {
+    m_index.clear();
+    m_results.clear();
+  }
+
+ private:
+  using key = std::pair<const object*, std::size_t>;
+  struct key_hash {
+    std::size_t operator()(const key& k) const {
+      return std::hash<const object*>{}(k.first) ^ (k.second * 0x9e3779b9);
+    }
+  };
+  std::unordered_map<key, const mstch::node*, key_hash> m_index;
+  std::deque<mstch::node> m_results;
+};
+
+}
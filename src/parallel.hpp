@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "mstch/mstch.hpp"
+
+namespace mstch {
+
+// Runs chunks 0 to chunks - 1 once each, on the pool and the calling thread.
+// Every thread taking part calls make_worker() before its first chunk, then
+// the callable it returned with each chunk index it claims. Returns once all
+// chunks ran and rethrows the first exception one of them threw.
+//
+// A pool task that starts after every chunk is claimed returns without
+// touching anything but the shared job, so the callables may refer to the
+// caller's stack.
+template<class MakeWorker>
+void parallel_chunks(
+    thread_pool& pool, std::size_t chunks, const MakeWorker& make_worker)
+{
+  struct job {
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t done = 0;
+    std::exception_ptr error;
+  };
+  auto shared = std::make_shared<job>();
+  auto work = [shared, chunks, &make_worker] {
+    std::optional<decltype(make_worker())> worker;
+    for (std::size_t chunk; (chunk = shared->next++) < chunks;) {
+      try {
+        if (!worker)
+          worker.emplace(make_worker());
+        (*worker)(chunk);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (!shared->error)
+          shared->error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      if (++shared->done == chunks)
+        shared->finished.notify_all();
+    }
+  };
+  for (std::size_t i = 0; i + 1 < chunks && i < pool.size(); ++i)
+    pool.submit(work);
+  work();
+
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->finished.wait(lock, [&] { return shared->done == chunks; });
+  if (shared->error)
+    std::rethrow_exception(shared->error);
+}
+
+}
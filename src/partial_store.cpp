@@ -0,0 +1,124 @@
+#include "partial_store.hpp"
+#include "template_file.hpp"
+
+#include <algorithm>
+
+using namespace mstch;
+
+partial_template::partial_template(
+    std::string source, const partial_store& partials):
+    m_source(std::move(source)), m_partials(partials)
+{
+}
+
+const template_type& partial_template::get() const {
+  std::call_once(m_compiled, [this] {
+    m_template = std::make_unique<template_type>(m_source);
+    m_template->resolve_partials(m_partials);
+  });
+  return *m_template;
+}
+
+void partial_template::compile(std::string_view source) {
+  std::call_once(m_compiled, [this, source] {
+    m_template = std::make_unique<template_type>(source);
+    m_template->resolve_partials(m_partials);
+  });
+}
+
+partial_store::partial_store(
+    const std::map<std::string, std::string>& partials)
+{
+  for (auto& partial: partials)
+    m_partials.emplace(std::piecewise_construct,
+        std::forward_as_tuple(partial.first),
+        std::forward_as_tuple(partial.second, *this));
+}
+
+const partial_template* partial_store::find(std::string_view name) const {
+  auto partial = m_partials.find(name);
+  return partial == m_partials.end() ? nullptr : &partial->second;
+}
+
+file_store::file_store(std::string directory):
+    m_directory(std::move(directory))
+{
+  if (!m_directory.empty() && m_directory.back() != '/')
+    m_directory += '/';
+}
+
+std::string file_store::path(std::string_view name) const {
+  std::string path{m_directory};
+  path.append(name).append(".mustache");
+  return path;
+}
+
+const partial_template* file_store::find(std::string_view name) const {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  auto cached = m_files.find(name);
+  if (cached != m_files.end())
+    return cached->second->partial.get();
+
+  auto file_path = path(name);
+  template_file source(file_path);
+  auto entry = std::make_shared<file>();
+  entry->mtime = source.mtime();
+  m_files[std::string{name}] = entry;
+  if (!source.is_open())
+    return nullptr;
+  // registered before compiling, so partials referring back to it resolve
+  entry->partial = std::make_unique<partial_template>(std::string{}, *this);
+  entry->partial->compile(source.contents());
+  for (auto& tag: entry->partial->get())
+    if (tag.token_type() == token::type::partial)
+      entry->partials.emplace_back(tag.name());
+  return entry->partial.get();
+}
+
+std::vector<std::string> file_store::closure(std::string_view name) const {
+  std::vector<std::string> names{std::string{name}};
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    auto entry = m_files.find(names[i]);
+    if (entry == m_files.end())
+      continue;
+    for (auto& partial: entry->second->partials)
+      if (std::find(names.begin(), names.end(), partial) == names.end())
+        names.push_back(partial);
+  }
+  return names;
+}
+
+bool file_store::is_fresh(std::string_view name) const {
+  std::vector<std::pair<std::string, std::int64_t>> loaded;
+  {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    for (auto& file: closure(name)) {
+      auto entry = m_files.find(file);
+      if (entry != m_files.end())
+        loaded.emplace_back(path(file), entry->second->mtime);
+    }
+  }
+  // stat outside the lock, other threads keep finding compiled files
+  for (auto& file: loaded)
+    if (template_file::mtime(file.first) != file.second)
+      return false;
+  return true;
+}
+
+std::shared_ptr<const file_store> file_store::refresh() const {
+  auto fresh = std::make_shared<file_store>(m_directory);
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  std::vector<std::string_view> changed;
+  for (auto& entry: m_files)
+    if (template_file::mtime(path(entry.first)) != entry.second->mtime)
+      changed.push_back(entry.first);
+  for (auto& entry: m_files) {
+    auto names = closure(entry.first);
+    if (std::none_of(names.begin(), names.end(), [&changed](auto& name) {
+          return std::find(changed.begin(), changed.end(), name) !=
+              changed.end();
+        }))
+      fresh->m_files.emplace(entry.first, entry.second);
+  }
+  return fresh;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "template_type.hpp"
+
+namespace mstch {
+
+class partial_store;
+
+class partial_template {
+ public:
+  partial_template(std::string source, const partial_store& partials);
+  const template_type& get() const;
+
+  // compiles source right away, for sources that don't outlive the call
+  void compile(std::string_view source);
+
+ private:
+  std::string m_source;
+  const partial_store& m_partials;
+  mutable std::once_flag m_compiled;
+  mutable std::unique_ptr<template_type> m_template;
+};
+
+class partial_store {
+ public:
+  partial_store() = default;
+  partial_store(const std::map<std::string, std::string>& partials);
+  partial_store(const partial_store&) = delete;
+  partial_store& operator=(const partial_store&) = delete;
+  virtual ~partial_store() = default;
+  virtual const partial_template* find(std::string_view name) const;
+
+ private:
+  std::map<std::string, partial_template, std::less<>> m_partials;
+};
+
+// partials loaded from "<directory>/<name>.mustache", each file is read and
+// compiled the first time a template or partial tag refers to it
+class file_store: public partial_store {
+ public:
+  file_store(std::string directory);
+  const partial_template* find(std::string_view name) const override;
+
+  // false once the file of name or of a partial it includes, directly or
+  // through other partials, changed, appeared or disappeared. Only stats the
+  // files of name, true if it wasn't loaded yet.
+  bool is_fresh(std::string_view name) const;
+
+  // store for the same directory that keeps the compiled files of this one
+  // whose file and partial files are all unchanged
+  std::shared_ptr<const file_store> refresh() const;
+
+  std::string path(std::string_view name) const;
+
+ private:
+  // Entries are shared with the stores refreshed from this one. Their partial
+  // tags point to the entries of their partials, which are always kept along
+  // with them. They are compiled when loaded, so they never use the store
+  // they were loaded by again.
+  struct file {
+    std::int64_t mtime;
+    std::unique_ptr<partial_template> partial;
+    // names of the partials the file includes
+    std::vector<std::string> partials;
+  };
+  using files = std::map<std::string, std::shared_ptr<const file>, std::less<>>;
+  std::string m_directory;
+  mutable std::recursive_mutex m_mutex;
+  mutable files m_files;
+
+  // name and the names of the partials it includes, directly or not
+  std::vector<std::string> closure(std::string_view name) const;
+};
+
+}
@@ -1,72 +1,267 @@
 #include "render_context.hpp"
-#include "state/outside_section.hpp"
+#include "parallel.hpp"
 #include "visitor/get_token.hpp"
+#include "visitor/is_node_empty.hpp"
+#include "visitor/render_node.hpp"
+#include "visitor/render_section.hpp"
 
 using namespace mstch;
 
 const mstch::node render_context::null_node;
 
 render_context::push::push(render_context& context, const mstch::node& node):
-    m_context(context)
+    m_context(context), m_object_results(context.m_object_results.size())
 {
-  context.m_nodes.emplace_front(node);
-  context.m_node_ptrs.emplace_front(&node);
-  context.m_state.push(std::unique_ptr<render_state>(new outside_section));
+  context.m_nodes.push_back(&node);
 }
 
 render_context::push::~push() {
-  m_context.m_nodes.pop_front();
-  m_context.m_node_ptrs.pop_front();
-  m_context.m_state.pop();
+  m_context.m_nodes.pop_back();
+  m_context.m_object_results.resize(m_object_results);
 }
 
-std::string render_context::push::render(const template_type& templt) {
-  return m_context.render(templt);
+void render_context::push::render(
+    const code_range& code, std::string& out, std::string_view prefix)
+{
+  m_context.render(code, out, prefix);
 }
 
 render_context::render_context(
     const mstch::node& node,
-    const std::map<std::string, template_type>& partials):
-    m_partials(partials), m_nodes(1, node), m_node_ptrs(1, &node)
+    const partial_store& partials,
+    const escape_function& escape,
+    thread_pool* pool,
+    std::size_t parallel_threshold,
+    std::shared_ptr<lookup_counters> lookups):
+    m_partials(&partials), m_escape(escape), m_nodes(1, &node),
+    m_pool(pool), m_parallel_threshold(parallel_threshold),
+    m_lookups(std::move(lookups))
 {
-  m_state.push(std::unique_ptr<render_state>(new outside_section));
 }
 
-const mstch::node& render_context::find_node(
-    const std::string& token,
-    std::list<node const*> current_nodes)
+// renders on a worker thread in the scope of parent, items of nested arrays
+// are rendered by the worker itself
+render_context::render_context(const render_context& parent, worker):
+    m_partials(parent.m_partials), m_escape(parent.m_escape),
+    m_nodes(parent.m_nodes), m_pool(nullptr), m_parallel_threshold(0),
+    m_lookups(parent.m_lookups)
 {
-  if (token != "." && token.find('.') != std::string::npos)
-    return find_node(token.substr(token.rfind('.') + 1),
-        {&find_node(token.substr(0, token.rfind('.')), current_nodes)});
-  else
-    for (auto& node: current_nodes)
-      if (visit(has_token(token), *node))
-        return visit(get_token(token, *node), *node);
-  return null_node;
 }
 
-const mstch::node& render_context::get_node(const std::string& token) {
-    return find_node(token, m_node_ptrs);
+render_context::~render_context() {
+  flush_lookups();
+}
+
+void render_context::flush_lookups() {
+  if (!m_lookups || (m_lookup_hits == 0 && m_lookup_misses == 0))
+    return;
+  m_lookups->hits.fetch_add(m_lookup_hits, std::memory_order_relaxed);
+  m_lookups->misses.fetch_add(m_lookup_misses, std::memory_order_relaxed);
+  m_lookup_hits = 0;
+  m_lookup_misses = 0;
+}
+
+void render_context::reset(const mstch::node& root) {
+  m_nodes.assign(1, &root);
+  m_object_results.clear();
+  m_memo.clear();
 }
 
-std::string render_context::render(
-    const template_type& templt, const std::string& prefix)
+void render_context::reset(
+    const mstch::node& root, const partial_store& partials)
 {
-  std::string output;
-  bool prev_eol = true;
-  for (auto& token: templt) {
+  m_partials = &partials;
+  reset(root);
+}
+
+// Searches the scopes from the innermost one out. The cached depth never
+// skips a scope: the scopes above the one that had the name last time are
+// searched as usual, in that one the key is first looked for at its previous
+// position. Only names found in a scope with positions are counted, a
+// std::map or a name that isn't there at all can't be cached.
+const mstch::node& render_context::get_node(const instruction& code)
+{
+  auto path = code.source().path();
+  auto cached = code.lookup();
+  const mstch::node* found = nullptr;
+  std::size_t depth = 0;
+  for (auto node = m_nodes.rbegin(); node != m_nodes.rend(); ++node, ++depth) {
+    key_position position;
+    if (depth == cached.first)
+      position.hint = cached.second;
+    found = visit(get_token(
+        path.front(), **node, m_object_results, m_memo, &position), **node);
+    if (!found)
+      continue;
+    if (position.found == key_position::npos)
+      break;
+    if (position.found == position.hint) {
+      ++m_lookup_hits;
+    } else {
+      ++m_lookup_misses;
+      code.lookup(depth, position.found);
+    }
+    break;
+  }
+
+  for (auto segment = path.begin() + 1; found && segment != path.end(); ++segment)
+    found = visit(
+        get_token(*segment, *found, m_object_results, m_memo), *found);
+
+  return found ? *found : null_node;
+}
+
+const mstch::node& render_context::get_node(const token::path_type& path)
+{
+  const mstch::node* found = nullptr;
+  for (auto node = m_nodes.rbegin(); node != m_nodes.rend() && !found; ++node)
+    found = visit(
+        get_token(path.front(), **node, m_object_results, m_memo), **node);
+
+  for (auto segment = path.begin() + 1; found && segment != path.end(); ++segment)
+    found = visit(
+        get_token(*segment, *found, m_object_results, m_memo), *found);
+
+  return found ? *found : null_node;
+}
+
+void render_context::render(
+    const code_range& code, std::string& out, std::string_view prefix)
+{
+  using op = instruction::op;
+  using flag = render_node::flag;
+  bool prev_eol = !code.section();
+  for (auto it = code.begin(); it != code.end(); ++it) {
     if (prev_eol && prefix.length() != 0)
-      output += m_state.top()->render(*this, {prefix});
-    output += m_state.top()->render(*this, token);
-    prev_eol = token.eol();
+      out += prefix;
+    auto& token = it->source();
+    switch (it->code()) {
+      case op::text:
+        out += token.raw();
+        break;
+      case op::variable:
+        std::visit(render_node(*this, out, flag::escape_html), get_node(*it));
+        break;
+      case op::unescaped_variable:
+        std::visit(render_node(*this, out, flag::none), get_node(*it));
+        break;
+      case op::partial:
+        render_partial(token, out);
+        break;
+      case op::section:
+      case op::inverted_section:
+        render_section_tag(*it, out, prefix);
+        break;
+    }
+    prev_eol = it->eol();
+    it += it->body_size();
+
+    if (&out == m_chunk_buffer && out.size() >= chunk_size) {
+      (*m_chunk_sink)(out.data(), out.size());
+      out.clear();
+    }
   }
-  return output;
+  if (code.tail() && prev_eol && prefix.length() != 0)
+    out += prefix;
+}
+
+void render_context::render(const code_range& code, const chunk_sink& sink) {
+  std::string buffer;
+  buffer.reserve(2 * chunk_size);
+  m_chunk_buffer = &buffer;
+  m_chunk_sink = &sink;
+  render(code, buffer);
+  if (!buffer.empty())
+    sink(buffer.data(), buffer.size());
+  m_chunk_buffer = nullptr;
+  m_chunk_sink = nullptr;
 }
 
-std::string render_context::render_partial(
-    const std::string& partial_name, const std::string& prefix)
+void render_context::render_section_tag(
+    const instruction& section, std::string& out, std::string_view prefix)
 {
-  return m_partials.count(partial_name) ?
-      render(m_partials.at(partial_name), prefix) : "";
+  auto& node = get_node(section);
+  if (section.code() == instruction::op::section) {
+    if (!visit(is_node_empty(), node))
+      visit(render_section(*this, out, node, section, prefix), node);
+  } else if (visit(is_node_empty(), node)) {
+    push(*this).render(template_type::body(section), out, prefix);
+  }
+}
+
+void render_context::escape(const std::string& str, std::string& out) const {
+  if (m_escape)
+    out += m_escape(str);
+  else
+    html_escape(str, out);
+}
+
+void render_context::escape(std::string_view str, std::string& out) const {
+  if (m_escape)
+    out += m_escape(std::string{str});
+  else
+    html_escape(str, out);
+}
+
+void render_context::render_partial(const token& token, std::string& out) {
+  auto partial = token.partial() ? token.partial() : m_partials->find(token.name());
+  if (partial)
+    render(partial->get(), out, token.partial_prefix());
+}
+
+bool render_context::render_parallel(
+    const mstch::node* items,
+    std::size_t count,
+    const instruction& section,
+    std::string& out,
+    std::string_view prefix)
+{
+  if (!m_pool || count < m_parallel_threshold || count < 2)
+    return false;
+
+  auto chunks = std::min(count, 4 * (m_pool->size() + 1));
+  std::vector<std::string> buffers(chunks);
+  parallel_chunks(*m_pool, chunks, [&] {
+    return [&, context = std::unique_ptr<render_context>(
+        new render_context(*this, worker{}))]
+        (std::size_t chunk) {
+      auto end = count * (chunk + 1) / chunks;
+      for (auto i = count * chunk / chunks; i < end; ++i)
+        std::visit(render_section(*context, buffers[chunk], items[i], section,
+            prefix, render_section::flag::keep_array), items[i]);
+      context->flush_lookups();
+    };
+  });
+
+  std::size_t size = out.size();
+  for (auto& buffer: buffers)
+    size += buffer.size();
+  out.reserve(size);
+  for (auto& buffer: buffers)
+    out += buffer;
+  return true;
+}
+
+void mstch::section::render(std::string& out) const {
+  if (m_begin != m_end)
+    render_context::push(m_ctx).render(
+        {m_begin, m_end, true, true}, out, m_prefix);
+}
+
+void mstch::section::render(const node& context, std::string& out) const {
+  if (m_begin != m_end)
+    render_context::push(m_ctx, context).render(
+        {m_begin, m_end, true, true}, out, m_prefix);
+}
+
+std::string mstch::section::render() const {
+  std::string out;
+  render(out);
+  return out;
+}
+
+std::string mstch::section::render(const node& context) const {
+  std::string out;
+  render(context, out);
+  return out;
 }
@@ -1,51 +1,93 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
-#include <list>
-#include <sstream>
+#include <memory>
 #include <string>
-#include <stack>
+#include <string_view>
 
 #include "mstch/mstch.hpp"
-#include "state/render_state.hpp"
 #include "template_type.hpp"
+#include "partial_store.hpp"
+#include "object_memo.hpp"
 
 namespace mstch {
 
+struct lookup_counters {
+  std::atomic<std::uint64_t> hits{0};
+  std::atomic<std::uint64_t> misses{0};
+};
+
 class render_context {
  public:
   class push {
    public:
     push(render_context& context, const mstch::node& node = {});
     ~push();
-    std::string render(const template_type& templt);
+    void render(
+        const code_range& code,
+        std::string& out,
+        std::string_view prefix = {});
    private:
     render_context& m_context;
+    std::size_t m_object_results;
   };
 
   render_context(
       const mstch::node& node,
-      const std::map<std::string, template_type>& partials);
-  const mstch::node& get_node(const std::string& token);
-  std::string render(
-      const template_type& templt, const std::string& prefix = "");
-  std::string render_partial(
-      const std::string& partial_name, const std::string& prefix);
-  template<class T, class... Args>
-  void set_state(Args&& ... args) {
-    m_state.top() = std::unique_ptr<render_state>(
-        new T(std::forward<Args>(args)...));
-  }
+      const partial_store& partials,
+      const escape_function& escape,
+      thread_pool* pool = nullptr,
+      std::size_t parallel_threshold = 0,
+      std::shared_ptr<lookup_counters> lookups = nullptr);
+  ~render_context();
+  // starts over with root as the only scope, keeping allocated memory
+  void reset(const mstch::node& root);
+  // the same, rendering the partials of partials from now on
+  void reset(const mstch::node& root, const partial_store& partials);
+  // looks up the name of a tag, trying its inline cache first
+  const mstch::node& get_node(const instruction& code);
+  const mstch::node& get_node(const token::path_type& path);
+  // adds the lookups counted so far to the counters
+  void flush_lookups();
+  void render(
+      const code_range& code,
+      std::string& out,
+      std::string_view prefix = {});
+  void render(const code_range& code, const chunk_sink& sink);
+  void escape(const std::string& str, std::string& out) const;
+  void escape(std::string_view str, std::string& out) const;
+  void render_partial(const token& partial, std::string& out);
+
+  // renders the items of a section over an array in chunks on the thread
+  // pool, false if the array is too small or there is no pool
+  bool render_parallel(
+      const mstch::node* items,
+      std::size_t count,
+      const instruction& section,
+      std::string& out,
+      std::string_view prefix);
 
  private:
+  struct worker {};
+  render_context(const render_context& parent, worker);
   static const mstch::node null_node;
-  const mstch::node& find_node(
-      const std::string& token,
-      std::list<node const*> current_nodes);
-  std::map<std::string, template_type> m_partials;
-  std::deque<mstch::node> m_nodes;
-  std::list<const mstch::node*> m_node_ptrs;
-  std::stack<std::unique_ptr<render_state>> m_state;
+  static const std::size_t chunk_size = 4096;
+  void render_section_tag(
+      const instruction& section, std::string& out, std::string_view prefix);
+  const partial_store* m_partials;
+  const escape_function& m_escape;
+  std::vector<const mstch::node*> m_nodes;
+  std::deque<mstch::node> m_object_results;
+  object_memo m_memo;
+  std::string* m_chunk_buffer = nullptr;
+  const chunk_sink* m_chunk_sink = nullptr;
+  thread_pool* m_pool;
+  std::size_t m_parallel_threshold;
+  std::shared_ptr<lookup_counters> m_lookups;
+  std::uint64_t m_lookup_hits = 0;
+  std::uint64_t m_lookup_misses = 0;
 };
 
 }
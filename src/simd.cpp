@@ -0,0 +1,82 @@
+#include "simd.hpp"
+
+using namespace mstch;
+
+namespace {
+
+using find_kernel = const char* (*)(const char*, const char*, char, char);
+
+const char* find_scalar(const char* begin, const char* end, char a, char b) {
+  for (auto it = begin; it != end; ++it)
+    if (*it == a || *it == b)
+      return it;
+  return end;
+}
+
+#ifdef MSTCH_X86_64
+
+const char* find_sse2(const char* begin, const char* end, char a, char b) {
+  const __m128i first = _mm_set1_epi8(a);
+  const __m128i second = _mm_set1_epi8(b);
+  auto it = begin;
+  for (; end - it >= 16; it += 16) {
+    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(block, first), _mm_cmpeq_epi8(block, second))));
+    if (mask != 0)
+      return it + first_bit(mask);
+  }
+  return find_scalar(it, end, a, b);
+}
+
+MSTCH_TARGET_AVX2
+const char* find_avx2(const char* begin, const char* end, char a, char b) {
+  const __m256i first = _mm256_set1_epi8(a);
+  const __m256i second = _mm256_set1_epi8(b);
+  auto it = begin;
+  for (; end - it >= 32; it += 32) {
+    auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+    auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(block, first), _mm256_cmpeq_epi8(block, second))));
+    if (mask != 0)
+      return it + first_bit(mask);
+  }
+  return find_sse2(it, end, a, b);
+}
+
+#endif
+
+find_kernel select_kernel() {
+#ifdef MSTCH_X86_64
+  return has_avx2() ? find_avx2 : find_sse2;
+#else
+  return find_scalar;
+#endif
+}
+
+}
+
+#ifdef MSTCH_X86_64
+bool mstch::has_avx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+      (_xgetbv(0) & 6) == 6;
+  __cpuidex(info, 7, 0);
+  return os_saves_ymm && (info[1] & (1 << 5));
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+const char* mstch::find_either(
+    const char* begin, const char* end, char a, char b)
+{
+  static const find_kernel kernel = select_kernel();
+  return kernel(begin, end, a, b);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MSTCH_X86_64
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MSTCH_TARGET_AVX2
+#else
+#define MSTCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
+
+namespace mstch {
+
+#ifdef MSTCH_X86_64
+// true if both the cpu and the os support avx2
+bool has_avx2();
+
+inline int first_bit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// first character in [begin, end) that is either a or b, end if none
+const char* find_either(const char* begin, const char* end, char a, char b);
+
+}
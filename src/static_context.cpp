@@ -0,0 +1,123 @@
+#include "mstch/static_template.hpp"
+#include "render_context.hpp"
+#include "lambda_cache.hpp"
+#include "visitor/is_node_empty.hpp"
+#include "visitor/render_node.hpp"
+
+using namespace mstch;
+using namespace mstch::internal;
+
+namespace {
+
+const partial_store no_partials;
+const node null_node;
+
+// a render context kept for the next render on the same thread, so rendering
+// a static template doesn't allocate one every time
+thread_local std::unique_ptr<render_context> spare_context;
+
+}
+
+static_context::static_context(const node& root, std::string& out):
+    static_context(root, out, no_partials)
+{
+}
+
+static_context::static_context(
+    const node& root, std::string& out, const partial_registry& partials):
+    static_context(root, out, *partials.m_partials)
+{
+}
+
+static_context::static_context(
+    const node& root, std::string& out, const partial_store& partials):
+    m_context(std::move(spare_context)),
+    m_out(out)
+{
+  if (m_context)
+    m_context->reset(root, partials);
+  else
+    m_context.reset(new render_context(root, partials, config::escape));
+}
+
+static_context::~static_context() {
+  if (!spare_context)
+    spare_context = std::move(m_context);
+}
+
+void static_context::variable(
+    const std::string_view* path, std::size_t size, bool escape)
+{
+  std::visit(render_node(*m_context, m_out, escape ?
+      render_node::flag::escape_html : render_node::flag::none),
+      m_context->get_node({path, size}));
+}
+
+void static_context::section(
+    const std::string_view* path, std::size_t size,
+    const static_section& body)
+{
+  auto& value = m_context->get_node({path, size});
+  if (std::visit(is_node_empty(), value))
+    return;
+  if (auto items = std::get_if<array>(&value)) {
+    for (auto& item: *items)
+      section_item(item, body);
+  } else if (auto items = std::get_if<arena_array>(&value)) {
+    for (auto& item: *items)
+      section_item(item, body);
+  } else if (auto items = std::get_if<bound>(&value); items && items->sequence()) {
+    items->each([&](const node& item) { section_item(item, body); });
+  } else {
+    section_item(value, body);
+  }
+}
+
+void static_context::inverted_section(
+    const std::string_view* path, std::size_t size,
+    const static_section& body)
+{
+  if (std::visit(is_node_empty(), m_context->get_node({path, size}))) {
+    render_context::push push{*m_context, null_node};
+    body.render(*this);
+  }
+}
+
+void static_context::section_item(const node& item, const static_section& body) {
+  if (auto fun = std::get_if<lambda>(&item)) {
+    lambda_section(*fun, body);
+  } else {
+    render_context::push push{*m_context, item};
+    body.render(*this);
+  }
+}
+
+// Lambdas get the body as the interpreter would pass it. Section lambdas get
+// it compiled at run time, through the lambda cache, without the prefix: the
+// section indents its lines itself when it is rendered.
+void static_context::lambda_section(
+    const lambda& fun, const static_section& body)
+{
+  auto renderer = [this](const mstch::node& n) {
+    std::string out;
+    std::visit(render_node(*m_context, out), n);
+    return out;
+  };
+  std::string text;
+  body.text(text, fun.takes_section() ? std::string_view{} : m_prefix);
+  delim_type delims{body.open, body.close};
+  if (fun.takes_section()) {
+    auto compiled = lambda_cache::get(text, delims);
+    code_range code = *compiled;
+    m_out += fun(renderer, mstch::section{
+        *m_context, code.begin(), code.end(), body.source, m_prefix});
+    return;
+  }
+  auto result = fun(renderer, text);
+  if (result.find(body.open) == std::string::npos) {
+    m_out += result;
+    return;
+  }
+  render_context::push(*m_context).render(
+      *lambda_cache::get(result, delims), m_out);
+}
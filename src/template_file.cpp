@@ -0,0 +1,72 @@
+#include "template_file.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace mstch;
+
+#ifdef _WIN32
+
+namespace {
+
+std::int64_t to_int64(const FILETIME& time) {
+  return (static_cast<std::int64_t>(time.dwHighDateTime) << 32) |
+      time.dwLowDateTime;
+}
+
+}
+
+std::int64_t template_file::mtime(const std::string& path) {
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+    return -1;
+  return to_int64(attributes.ftLastWriteTime);
+}
+
+#else
+
+namespace {
+
+std::int64_t to_int64(const struct stat& info) {
+#if defined(__APPLE__)
+  return static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 +
+      info.st_mtimespec.tv_nsec;
+#else
+  return static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 +
+      info.st_mtim.tv_nsec;
+#endif
+}
+
+}
+
+std::int64_t template_file::mtime(const std::string& path) {
+  struct stat info;
+  if (::stat(path.c_str(), &info) != 0)
+    return -1;
+  return to_int64(info);
+}
+
+#endif
+
+// The modification time is taken before reading, a change while the file is
+// read only makes the next check load it again
+template_file::template_file(const std::string& path):
+    m_open(false), m_mtime(mtime(path))
+{
+  if (m_mtime < 0)
+    return;
+  std::ifstream input(path, std::ios::binary);
+  if (!input)
+    return;
+  m_contents.assign(std::istreambuf_iterator<char>(input),
+      std::istreambuf_iterator<char>());
+  m_open = !input.bad();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace mstch {
+
+// contents of a template file, read into memory along with its modification
+// time in the constructor
+class template_file {
+ public:
+  template_file(const std::string& path);
+  bool is_open() const { return m_open; }
+  const std::string& contents() const { return m_contents; }
+  std::int64_t mtime() const { return m_mtime; }
+
+  // modification time of the file at path, or -1 if it doesn't exist
+  static std::int64_t mtime(const std::string& path);
+
+ private:
+  bool m_open;
+  std::string m_contents;
+  std::int64_t m_mtime;
+};
+
+}
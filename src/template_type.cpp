@@ -1,74 +1,112 @@
 #include "template_type.hpp"
+#include "partial_store.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <iterator>
 
 using namespace mstch;
 
-template_type::template_type(const std::string& str, const delim_type& delims):
+template_type::template_type(std::string_view str, const delim_type& delims):
     m_open(delims.first), m_close(delims.second)
 {
-  tokenize(str);
+  tokenize(copy_source(str));
   strip_whitespace();
+  link_sections(0, m_tokens.size());
+  split_paths();
+  m_code.reserve(m_tokens.size());
+  m_tail = compile(0, m_tokens.size()) < m_tokens.size();
 }
 
-template_type::template_type(const std::string& str):
+template_type::template_type(std::string_view str):
     m_open("{{"), m_close("}}")
 {
-  tokenize(str);
+  tokenize(copy_source(str));
   strip_whitespace();
+  link_sections(0, m_tokens.size());
+  split_paths();
+  m_code.reserve(m_tokens.size());
+  m_tail = compile(0, m_tokens.size()) < m_tokens.size();
+}
+
+std::string_view template_type::copy_source(std::string_view str) {
+  m_source.reset(new char[str.size()]);
+  std::copy(str.begin(), str.end(), m_source.get());
+  return {m_source.get(), str.size()};
 }
 
-void template_type::process_text(citer begin, citer end) {
-  if (begin == end)
-    return;
-  auto start = begin;
-  for (auto it = begin; it != end; ++it)
-    if (*it == '\n' || it == end - 1) {
-      m_tokens.push_back({{start, it + 1}});
-      start = it + 1;
+void template_type::process_text(std::string_view text) {
+  std::size_t start = 0;
+  for (std::size_t pos = 0; pos < text.size(); ++pos)
+    if (text[pos] == '\n' || pos == text.size() - 1) {
+      m_tokens.push_back({text.substr(start, pos + 1 - start)});
+      start = pos + 1;
     }
 }
 
-void template_type::tokenize(const std::string& tmp) {
+// A single pass over the source looks for newlines and the first character
+// of the open delimiter together: a newline ends the current text token, a
+// delimiter starts a tag.
+void template_type::tokenize(std::string_view tmp) {
   citer beg = tmp.begin();
-  auto npos = std::string::npos;
+  auto npos = std::string_view::npos;
+  auto char_at = [&tmp](std::size_t pos) {
+    return pos < tmp.size() ? tmp[pos] : '\0';
+  };
 
+  std::size_t text_pos = 0;
   for (std::size_t cur_pos = 0; cur_pos < tmp.size();) {
-    auto open_pos = tmp.find(m_open, cur_pos);
-    auto close_pos = tmp.find(
-        m_close, open_pos == npos ? open_pos : open_pos + 1);
-
-    if (close_pos != npos && open_pos != npos) {
-      if (*(beg + open_pos + m_open.size()) == '{' &&
-          *(beg + close_pos + m_close.size()) == '}')
-        ++close_pos;
-
-      process_text(beg + cur_pos, beg + open_pos);
-      cur_pos = close_pos + m_close.size();
-      m_tokens.push_back({{beg + open_pos, beg + close_pos + m_close.size()},
-          m_open.size(), m_close.size()});
-
-      if (cur_pos == tmp.size()) {
-        m_tokens.push_back({{""}});
-        m_tokens.back().eol(true);
+    auto open_pos = static_cast<std::size_t>(find_either(
+        tmp.data() + cur_pos, tmp.data() + tmp.size(),
+        '\n', m_open.empty() ? '\n' : m_open[0]) - tmp.data());
+    if (open_pos == tmp.size())
+      break;
+    if (tmp.compare(open_pos, m_open.size(), m_open) != 0) {
+      if (tmp[open_pos] == '\n') {
+        m_tokens.push_back({tmp.substr(text_pos, open_pos + 1 - text_pos)});
+        text_pos = open_pos + 1;
       }
+      cur_pos = open_pos + 1;
+      continue;
+    }
 
-      if (*(beg + open_pos + m_open.size()) == '=' &&
-          *(beg + close_pos - 1) == '=')
-      {
-        auto tok_beg = beg + open_pos + m_open.size() + 1;
-        auto tok_end = beg + close_pos - 1;
-        auto front_skip = first_not_ws(tok_beg, tok_end);
-        auto back_skip = first_not_ws(reverse(tok_end), reverse(tok_beg));
-        m_open = {front_skip, beg + tmp.find(' ', front_skip - beg)};
-        m_close = {beg + tmp.rfind(' ', back_skip - beg) + 1, back_skip + 1};
-      }
-    } else {
-      process_text(beg + cur_pos, tmp.end());
-      cur_pos = close_pos;
+    auto close_pos = tmp.find(m_close, open_pos + 1);
+    if (close_pos == npos)
+      break;
+    if (char_at(open_pos + m_open.size()) == '{' &&
+        char_at(close_pos + m_close.size()) == '}')
+      ++close_pos;
+
+    if (open_pos != text_pos)
+      m_tokens.push_back({tmp.substr(text_pos, open_pos - text_pos)});
+    cur_pos = text_pos = close_pos + m_close.size();
+    m_tokens.push_back({tmp.substr(open_pos, cur_pos - open_pos),
+        m_open.size(), m_close.size()});
+
+    if (cur_pos == tmp.size()) {
+      m_tokens.push_back({tmp.substr(cur_pos)});
+      m_tokens.back().eol(true);
+    }
+
+    if (char_at(open_pos + m_open.size()) == '=' &&
+        char_at(close_pos - 1) == '=')
+    {
+      auto tok_beg = beg + open_pos + m_open.size() + 1;
+      auto tok_end = beg + close_pos - 1;
+      std::size_t front_skip = first_not_ws(tok_beg, tok_end) - beg;
+      std::size_t back_skip =
+          first_not_ws(reverse(tok_end), reverse(tok_beg)) - beg;
+      m_open = tmp.substr(front_skip, tmp.find(' ', front_skip) - front_skip);
+      auto close_begin = tmp.rfind(' ', back_skip) + 1;
+      m_close = tmp.substr(close_begin, back_skip + 1 - close_begin);
     }
   }
+  process_text(tmp.substr(text_pos));
 }
 
+// compacts the tokens in place, kept tokens only ever move to the front
 void template_type::strip_whitespace() {
+  auto kept = m_tokens.begin();
   auto line_begin = m_tokens.begin();
   bool has_tag = false, non_space = false;
 
@@ -81,19 +119,20 @@ void template_type::strip_whitespace() {
       non_space = true;
 
     if ((*it).eol()) {
-      if (has_tag && !non_space) {
+      bool standalone = has_tag && !non_space;
+      if (standalone)
         store_prefixes(line_begin);
 
-        auto c = line_begin;
-        for (bool end = false; !end; (*c).ws_only() ? c = m_tokens.erase(c) : ++c)
-          if ((end = (*c).eol()))
-            it = c - 1;
-      }
+      for (auto c = line_begin; c != it + 1; ++c)
+        if (!standalone || !(*c).ws_only())
+          *kept++ = *c;
 
       non_space = has_tag = false;
       line_begin = it + 1;
     }
   }
+  kept = std::copy(line_begin, m_tokens.end(), kept);
+  m_tokens.erase(kept, m_tokens.end());
 }
 
 void template_type::store_prefixes(std::vector<token>::iterator beg) {
@@ -102,3 +141,107 @@ void template_type::store_prefixes(std::vector<token>::iterator beg) {
         cur != beg && (*(cur - 1)).ws_only())
       (*cur).partial_prefix((*(cur - 1)).raw());
 }
+
+void template_type::link_sections(std::size_t begin, std::size_t end) {
+  for (auto open = begin; open < end; ++open) {
+    auto type = m_tokens[open].token_type();
+    if (type != token::type::section_open &&
+        type != token::type::inverted_section_open)
+      continue;
+
+    int skipped_openings = 0;
+    auto close = open + 1;
+    for (; close < end; ++close) {
+      auto& token = m_tokens[close];
+      if (token.token_type() == token::type::section_close) {
+        if (token.name() == m_tokens[open].name() && skipped_openings == 0)
+          break;
+        skipped_openings--;
+      } else if (token.token_type() == token::type::inverted_section_open ||
+          token.token_type() == token::type::section_open) {
+        skipped_openings++;
+      }
+    }
+    if (close == end)
+      return;
+
+    m_tokens[open].section_end(close - open);
+    link_sections(open + 1, close);
+    open = close;
+  }
+}
+
+std::string_view template_type::section_source(const token& open) {
+  auto tokens = section_tokens(open);
+  if (tokens.begin() == tokens.end())
+    return {};
+  auto first = tokens.begin()->raw();
+  auto last = std::prev(tokens.end())->raw();
+  return {first.data(),
+      static_cast<std::size_t>(last.data() + last.size() - first.data())};
+}
+
+void template_type::resolve_partials(const partial_store& partials) {
+  for (auto& token: m_tokens)
+    if (token.token_type() == token::type::partial)
+      token.partial(partials.find(token.name()));
+}
+
+void template_type::split_paths() {
+  std::size_t segments = 0;
+  for (auto& token: m_tokens)
+    if (token.token_type() != token::type::text)
+      segments += std::count(token.name().begin(), token.name().end(), '.') + 1;
+  m_paths.reserve(segments);
+  for (auto& token: m_tokens)
+    if (token.token_type() != token::type::text) {
+      auto begin = m_paths.size();
+      token.path(m_paths.data() + begin, token::split_path(token.name(), m_paths));
+    }
+}
+
+// returns the index past the last token that got an instruction
+std::size_t template_type::compile(std::size_t begin, std::size_t end) {
+  using op = instruction::op;
+  auto last = begin;
+  for (auto i = begin; i < end; ++i) {
+    auto& token = m_tokens[i];
+    switch (token.token_type()) {
+      case token::type::text:
+        m_code.emplace_back(op::text, token);
+        last = i + 1;
+        break;
+      case token::type::variable:
+        m_code.emplace_back(op::variable, token);
+        last = i + 1;
+        break;
+      case token::type::unescaped_variable:
+        m_code.emplace_back(op::unescaped_variable, token);
+        last = i + 1;
+        break;
+      case token::type::partial:
+        m_code.emplace_back(op::partial, token);
+        last = i + 1;
+        break;
+      case token::type::section_open:
+      case token::type::inverted_section_open: {
+        // nothing after a section without an end is rendered
+        if (token.section_end() == 0)
+          return last;
+        auto section = m_code.size();
+        m_code.emplace_back(
+            token.token_type() == token::type::section_open ?
+                op::section : op::inverted_section,
+            token);
+        compile(i + 1, i + token.section_end());
+        m_code[section].body_size(m_code.size() - section - 1);
+        i += token.section_end();
+        last = i + 1;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  return last;
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "token.hpp"
@@ -8,23 +11,146 @@
 
 namespace mstch {
 
+class token_range {
+ public:
+  token_range(const token* begin, const token* end):
+      m_begin(begin), m_end(end)
+  {
+  }
+  const token* begin() const { return m_begin; }
+  const token* end() const { return m_end; }
+
+ private:
+  const token* m_begin;
+  const token* m_end;
+};
+
+// Templates compile to a flat list of instructions. A section is followed by
+// the instructions of its body, body_size tells how many to skip over it.
+// Tokens that never produce output, like comments, delimiter changes and
+// section ends, don't get an instruction.
+//
+// Instructions that look up a name carry an inline cache of where the name
+// was found the last time: how many scopes down the context stack, and the
+// position of the key in that scope. The cache is only a hint, it is shared
+// by all threads rendering the template and updated without ordering.
+class instruction {
+ public:
+  enum class op: std::uint8_t {
+    text, variable, unescaped_variable, section, inverted_section, partial
+  };
+  static constexpr std::uint32_t no_lookup = 0xffffffff;
+  static constexpr std::size_t max_lookup_depth = 0xfe;
+  static constexpr std::size_t max_lookup_position = 0xffffff;
+
+  instruction(op code, const token& source):
+      m_source(&source), m_body_size(0), m_lookup(no_lookup), m_code(code)
+  {
+  }
+  instruction(const instruction& other):
+      m_source(other.m_source), m_body_size(other.m_body_size),
+      m_lookup(other.m_lookup.load(std::memory_order_relaxed)),
+      m_code(other.m_code)
+  {
+  }
+  instruction& operator=(const instruction& other) {
+    m_source = other.m_source;
+    m_body_size = other.m_body_size;
+    m_lookup.store(other.m_lookup.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    m_code = other.m_code;
+    return *this;
+  }
+  op code() const { return m_code; }
+  const token& source() const { return *m_source; }
+  bool eol() const { return m_source->eol(); }
+  std::size_t body_size() const { return m_body_size; }
+  void body_size(std::size_t body_size) {
+    m_body_size = static_cast<std::uint32_t>(body_size);
+  }
+
+  // depth and position of the last lookup, depth is max_lookup_depth + 1
+  // when there is none
+  std::pair<std::size_t, std::size_t> lookup() const {
+    auto lookup = m_lookup.load(std::memory_order_relaxed);
+    return {lookup >> 24, lookup & max_lookup_position};
+  }
+  void lookup(std::size_t depth, std::size_t position) const {
+    if (depth <= max_lookup_depth && position <= max_lookup_position)
+      m_lookup.store(static_cast<std::uint32_t>(depth << 24 | position),
+          std::memory_order_relaxed);
+  }
+
+ private:
+  const token* m_source;
+  std::uint32_t m_body_size;
+  mutable std::atomic<std::uint32_t> m_lookup;
+  op m_code;
+};
+
+// tail is set when a token without an instruction follows the last
+// instruction, like the end of a section or a trailing comment. A partial's
+// prefix still goes before it when it starts a line.
+class code_range {
+ public:
+  code_range(
+      const instruction* begin, const instruction* end,
+      bool section = false, bool tail = false):
+      m_begin(begin), m_end(end), m_section(section), m_tail(tail)
+  {
+  }
+  const instruction* begin() const { return m_begin; }
+  const instruction* end() const { return m_end; }
+  bool section() const { return m_section; }
+  bool tail() const { return m_tail; }
+
+ private:
+  const instruction* m_begin;
+  const instruction* m_end;
+  bool m_section;
+  bool m_tail;
+};
+
+class partial_store;
+
+// tokens of a template, the template keeps its own copy of the source that
+// all token views point into
 class template_type {
  public:
   template_type() = default;
-  template_type(const std::string& str);
-  template_type(const std::string& str, const delim_type& delims);
+  template_type(std::string_view str);
+  template_type(std::string_view str, const delim_type& delims);
   std::vector<token>::const_iterator begin() const { return m_tokens.begin(); }
   std::vector<token>::const_iterator end() const { return m_tokens.end(); }
-  void operator<<(const token& token) { m_tokens.push_back(token); }
+  operator code_range() const {
+    return {m_code.data(), m_code.data() + m_code.size(), false, m_tail};
+  }
+  void resolve_partials(const partial_store& partials);
+  static code_range body(const instruction& section) {
+    return {&section + 1, &section + 1 + section.body_size(), true, true};
+  }
+  static token_range section_tokens(const token& open) {
+    return {&open + 1, &open + open.section_end()};
+  }
+  // the body of a section as written in the source
+  static std::string_view section_source(const token& open);
 
  private:
+  std::unique_ptr<char[]> m_source;
   std::vector<token> m_tokens;
-  std::string m_open;
-  std::string m_close;
+  std::vector<std::string_view> m_paths;
+  std::vector<instruction> m_code;
+  std::string_view m_open;
+  std::string_view m_close;
+  bool m_tail = false;
+  std::string_view copy_source(std::string_view str);
   void strip_whitespace();
-  void process_text(citer beg, citer end);
-  void tokenize(const std::string& tmp);
+  void process_text(std::string_view text);
+  void tokenize(std::string_view tmp);
+  void split_paths();
+  std::size_t compile(std::size_t begin, std::size_t end);
   void store_prefixes(std::vector<token>::iterator beg);
+  void link_sections(std::size_t begin, std::size_t end);
 };
 
 }
@@ -0,0 +1,64 @@
+#include "mstch/mstch.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace mstch;
+
+struct mstch::thread_pool::state {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+
+  void run() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+mstch::thread_pool::thread_pool(std::size_t threads):
+    m_state(std::make_unique<state>())
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  m_state->threads.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i)
+    m_state->threads.emplace_back([this] { m_state->run(); });
+}
+
+mstch::thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->stopping = true;
+  }
+  m_state->ready.notify_all();
+  for (auto& thread: m_state->threads)
+    thread.join();
+}
+
+std::size_t mstch::thread_pool::size() const {
+  return m_state->threads.size();
+}
+
+void mstch::thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->tasks.push_back(std::move(task));
+  }
+  m_state->ready.notify_one();
+}
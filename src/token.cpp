@@ -15,28 +15,31 @@ token::type token::token_info(char c) {
   }
 }
 
-token::token(const std::string& str, std::size_t left, std::size_t right):
-    m_raw(str), m_eol(false), m_ws_only(false)
+token::token(std::string_view str, std::size_t left, std::size_t right):
+    m_raw(str), m_path(nullptr), m_partial(nullptr), m_path_size(0),
+    m_section_end(0), m_left(0), m_right(0), m_eol(false), m_ws_only(false)
 {
   if (left != 0 && right != 0) {
     if (str[left] == '=' && str[str.size() - right - 1] == '=') {
       m_type = type::delimiter_change;
     } else if (str[left] == '{' && str[str.size() - right - 1] == '}') {
       m_type = type::unescaped_variable;
-      m_name = {first_not_ws(str.begin() + left + 1, str.end() - right),
-          first_not_ws(str.rbegin() + 1 + right, str.rend() - left) + 1};
+      m_name = make_view(str,
+          first_not_ws(str.begin() + left + 1, str.end() - right),
+          first_not_ws(str.rbegin() + 1 + right, str.rend() - left) + 1);
     } else {
       auto c = first_not_ws(str.begin() + left, str.end() - right);
       m_type = token_info(*c);
       if (m_type != type::variable)
         c = first_not_ws(c + 1, str.end() - right);
-      m_name = {c, first_not_ws(str.rbegin() + right, str.rend() - left) + 1};
-      m_delims = {{str.begin(), str.begin() + left},
-          {str.end() - right, str.end()}};
+      m_name = make_view(str,
+          c, first_not_ws(str.rbegin() + right, str.rend() - left) + 1);
+      m_left = static_cast<std::uint16_t>(left);
+      m_right = static_cast<std::uint16_t>(right);
     }
   } else {
     m_type = type::text;
     m_eol = (str.size() > 0 && str[str.size() - 1] == '\n');
-    m_ws_only = (str.find_first_not_of(" \r\n\t") == std::string::npos);
+    m_ws_only = (str.find_first_not_of(" \r\n\t") == std::string_view::npos);
   }
 }
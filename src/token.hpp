@@ -1,39 +1,96 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
+#include <string_view>
+#include <utility>
 
 namespace mstch {
 
-using delim_type = std::pair<std::string, std::string>;
+using delim_type = std::pair<std::string_view, std::string_view>;
 
+class partial_template;
+
+// token of a template_type, all views point into the template's source
 class token {
  public:
-  enum class type {
+  enum class type: std::uint8_t {
     text, variable, section_open, section_close, inverted_section_open,
     unescaped_variable, comment, partial, delimiter_change
   };
-  token(const std::string& str, std::size_t left = 0, std::size_t right = 0);
+
+  // dotted name split into its segments
+  class path_type {
+   public:
+    path_type(const std::string_view* begin, std::size_t size):
+        m_begin(begin), m_size(size)
+    {
+    }
+    const std::string_view* begin() const { return m_begin; }
+    const std::string_view* end() const { return m_begin + m_size; }
+    const std::string_view& front() const { return *m_begin; }
+    std::size_t size() const { return m_size; }
+
+   private:
+    const std::string_view* m_begin;
+    std::size_t m_size;
+  };
+
+  token(std::string_view str, std::size_t left = 0, std::size_t right = 0);
   type token_type() const { return m_type; };
-  const std::string& raw() const { return m_raw; };
-  const std::string& name() const { return m_name; };
-  const std::string& partial_prefix() const { return m_partial_prefix; };
-  const delim_type& delims() const { return m_delims; };
-  void partial_prefix(const std::string& p_partial_prefix) {
+  std::string_view raw() const { return m_raw; };
+  std::string_view name() const { return m_name; };
+  path_type path() const { return {m_path, m_path_size}; };
+  void path(const std::string_view* path, std::size_t size) {
+    m_path = path;
+    m_path_size = static_cast<std::uint32_t>(size);
+  }
+  std::string_view partial_prefix() const { return m_partial_prefix; };
+  void partial_prefix(std::string_view p_partial_prefix) {
     m_partial_prefix = p_partial_prefix;
   };
+  delim_type delims() const {
+    return {m_raw.substr(0, m_left), m_raw.substr(m_raw.size() - m_right)};
+  }
   bool eol() const { return m_eol; }
   void eol(bool eol) { m_eol = eol; }
   bool ws_only() const { return m_ws_only; }
+  const partial_template* partial() const { return m_partial; }
+  void partial(const partial_template* partial) { m_partial = partial; }
+  std::size_t section_end() const { return m_section_end; }
+  void section_end(std::size_t section_end) {
+    m_section_end = static_cast<std::uint32_t>(section_end);
+  }
+
+  // appends the segments of name to path and returns how many there are
+  template<class Vector>
+  static std::size_t split_path(std::string_view name, Vector& path);
 
  private:
+  std::string_view m_raw;
+  std::string_view m_name;
+  std::string_view m_partial_prefix;
+  const std::string_view* m_path;
+  const partial_template* m_partial;
+  std::uint32_t m_path_size;
+  std::uint32_t m_section_end;
+  std::uint16_t m_left;
+  std::uint16_t m_right;
   type m_type;
-  std::string m_name;
-  std::string m_raw;
-  std::string m_partial_prefix;
-  delim_type m_delims;
   bool m_eol;
   bool m_ws_only;
   type token_info(char c);
 };
 
+template<class Vector>
+std::size_t token::split_path(std::string_view name, Vector& path) {
+  auto dot = name.rfind('.');
+  if (name != "." && dot != std::string_view::npos) {
+    auto size = split_path(name.substr(0, dot), path);
+    path.push_back(name.substr(dot + 1));
+    return size + 1;
+  }
+  path.push_back(name);
+  return 1;
+}
+
 }
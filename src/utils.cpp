@@ -1,44 +1,30 @@
 #include "utils.hpp"
-#include "mstch/mstch.hpp"
 
-mstch::citer mstch::first_not_ws(mstch::citer begin, mstch::citer end) {
-  for (auto it = begin; it != end; ++it)
-    if (*it != ' ') return it;
-  return end;
-}
-
-mstch::citer mstch::first_not_ws(mstch::criter begin, mstch::criter end) {
-  for (auto rit = begin; rit != end; ++rit)
-    if (*rit != ' ') return --(rit.base());
-  return --(end.base());
-}
-
-mstch::criter mstch::reverse(mstch::citer it) {
-  return std::reverse_iterator<mstch::citer>(it);
-}
-
-std::string mstch::html_escape(const std::string& str) {
-  if (mstch::config::escape)
-    return mstch::config::escape(str);
-  
-  std::string out;
-  citer start = str.begin();
-
-  auto add_escape = [&out, &start](const std::string& escaped, citer& it) {
-    out += std::string{start, it} + escaped;
-    start = it + 1;
-  };
+#include <locale>
+#include <sstream>
 
-  for (auto it = str.begin(); it != str.end(); ++it)
-    switch (*it) {
-      case '&': add_escape("&amp;", it); break;
-      case '\'': add_escape("&#39;", it); break;
-      case '"': add_escape("&quot;", it); break;
-      case '<': add_escape("&lt;", it); break;
-      case '>': add_escape("&gt;", it); break;
-      case '/': add_escape("&#x2F;", it); break;
-      default: break;
-    }
 
-  return out + std::string{start, str.end()};
+void mstch::append_double(double value, std::string& out) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+#else
+  // no floating point std::to_chars, find the shortest round trip precision
+  // with streams in the classic locale, which neither groups digits nor uses
+  // another decimal separator
+  std::ostringstream stream;
+  stream.imbue(std::locale::classic());
+  for (int precision = 1; precision <= 17; ++precision) {
+    stream.str({});
+    stream.precision(precision);
+    stream << value;
+    std::istringstream input(stream.str());
+    input.imbue(std::locale::classic());
+    double parsed = 0;
+    if (input >> parsed && parsed == value)
+      break;
+  }
+  out += stream.str();
+#endif
 }
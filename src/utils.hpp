@@ -1,17 +1,51 @@
 #pragma once
 
+#include <charconv>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <variant>
 
 namespace mstch {
 
-using citer = std::string::const_iterator;
-using criter = std::string::const_reverse_iterator;
+using citer = std::string_view::const_iterator;
+using criter = std::string_view::const_reverse_iterator;
 
-citer first_not_ws(citer begin, citer end);
-citer first_not_ws(criter begin, criter end);
-std::string html_escape(const std::string& str);
-criter reverse(citer it);
+template<class It>
+It first_not_ws(It begin, It end) {
+  for (auto it = begin; it != end; ++it)
+    if (*it != ' ') return it;
+  return end;
+}
+
+template<class It>
+It first_not_ws(std::reverse_iterator<It> begin, std::reverse_iterator<It> end) {
+  for (auto rit = begin; rit != end; ++rit)
+    if (*rit != ' ') return std::prev(rit.base());
+  return std::prev(end.base());
+}
+
+template<class It>
+std::reverse_iterator<It> reverse(It it) {
+  return std::reverse_iterator<It>(it);
+}
+
+// view of the part of str between two of its iterators, empty if end < begin
+inline std::string_view make_view(std::string_view str, citer begin, citer end) {
+  if (end < begin)
+    return str.substr(begin - str.begin(), 0);
+  return str.substr(begin - str.begin(), end - begin);
+}
+
+void html_escape(std::string_view str, std::string& out);
+void append_double(double value, std::string& out);
+
+template<class T>
+void append_integer(T value, std::string& out) {
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+}
 
 template<class Visitor, class Visited>
 decltype(auto) visit(Visitor&& visitor, Visited&& node) {
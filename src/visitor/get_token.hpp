@@ -1,33 +1,115 @@
 #pragma once
 
+#include <deque>
+
 #include "mstch/mstch.hpp"
-#include "has_token.hpp"
+#include "object_memo.hpp"
 
 namespace mstch {
 
+// Where a key sits in its scope: the index of a flat_map or arena_map entry
+// or the slot of an object method or bound field. The hint is tried before
+// searching, found is set to the position the key was found at.
+struct key_position {
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+  std::size_t hint = npos;
+  std::size_t found = npos;
+};
+
 class get_token {
  public:
-  get_token(const std::string& token, const mstch::node& node):
-      m_token(token), m_node(node)
+  get_token(
+      std::string_view token,
+      const mstch::node& node,
+      std::deque<mstch::node>& object_results,
+      object_memo& memo,
+      key_position* position = nullptr):
+      m_token(token), m_node(node), m_object_results(object_results),
+      m_memo(memo), m_position(position)
   {
   }
 
   template<class T>
-  const mstch::node& operator()(const T&) const {
-    return m_node;
+  const mstch::node* operator()(const T&) const {
+    if (m_token != ".")
+      return nullptr;
+    if (m_position)
+      m_position->found = 0;
+    return &m_node;
   }
 
-  const mstch::node& operator()(const map& map) const {
-    return map.at(m_token);
+  const mstch::node* operator()(const map& map) const {
+    auto it = map.find(m_token);
+    return it == map.end() ? nullptr : &it->second;
   }
 
-  const mstch::node& operator()(const std::shared_ptr<object>& object) const {
-    return object->at(m_token);
+  const mstch::node* operator()(const flat_map& map) const {
+    return find_entry(map);
+  }
+
+  const mstch::node* operator()(const arena_map& map) const {
+    return find_entry(map);
+  }
+
+  const mstch::node* operator()(const std::shared_ptr<object>& object) const {
+    auto slot = object::npos;
+    if (m_position && m_position->hint < object->size() &&
+        object->name(m_position->hint) == m_token)
+      slot = m_position->hint;
+    else
+      slot = object->slot(m_token);
+    if (slot == object::npos)
+      return nullptr;
+    if (m_position)
+      m_position->found = slot;
+    switch (object->policy(slot)) {
+      case memoize::per_object:
+        return &object->memoized(slot);
+      case memoize::per_render:
+        return &m_memo.get(*object, slot);
+      default:
+        return &m_object_results.emplace_back(object->invoke(slot));
+    }
+  }
+
+  // fields are read into the object results like methods that aren't memoized
+  const mstch::node* operator()(const bound& value) const {
+    auto slot = bound::npos;
+    if (m_position && m_position->hint < value.size() &&
+        value.name(m_position->hint) == m_token)
+      slot = m_position->hint;
+    else
+      slot = value.slot(m_token);
+    if (slot == bound::npos)
+      return operator()<bound>(value);
+    if (m_position)
+      m_position->found = slot;
+    return &m_object_results.emplace_back(value.field(slot));
   }
 
  private:
-  const std::string& m_token;
+  template<class M>
+  const mstch::node* find_entry(const M& map) const {
+    if (m_position && m_position->hint < map.size()) {
+      auto& entry = map.begin()[m_position->hint];
+      if (entry.first == m_token) {
+        m_position->found = m_position->hint;
+        return &entry.second;
+      }
+    }
+    auto it = map.find(m_token);
+    if (it == map.end())
+      return nullptr;
+    if (m_position)
+      m_position->found = static_cast<std::size_t>(it - map.begin());
+    return &it->second;
+  }
+
+  std::string_view m_token;
   const mstch::node& m_node;
+  std::deque<mstch::node>& m_object_results;
+  object_memo& m_memo;
+  key_position* m_position;
 };
 
 }
@@ -19,6 +19,14 @@ class is_node_empty {
     return value == 0;
   }
 
+  bool operator()(const std::int64_t& value) const {
+    return value == 0;
+  }
+
+  bool operator()(const std::uint64_t& value) const {
+    return value == 0;
+  }
+
   bool operator()(const double& value) const {
     return value == 0;
   }
@@ -31,9 +39,21 @@ class is_node_empty {
     return value == "";
   }
 
+  bool operator()(const string_view_node& value) const {
+    return value.empty();
+  }
+
   bool operator()(const array& array) const {
     return array.size() == 0;
   }
+
+  bool operator()(const arena_array& array) const {
+    return array.empty();
+  }
+
+  bool operator()(const bound& value) const {
+    return value.empty();
+  }
 };
 
 }
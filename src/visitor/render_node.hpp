@@ -1,8 +1,7 @@
 #pragma once
 
-#include <sstream>
-
 #include "render_context.hpp"
+#include "lambda_cache.hpp"
 #include "mstch/mstch.hpp"
 #include "utils.hpp"
 
@@ -11,38 +10,70 @@ namespace mstch {
 class render_node {
 public:
   enum class flag { none, escape_html };
-  render_node(render_context& ctx, flag p_flag = flag::none):
-    m_ctx(ctx), m_flag(p_flag)
+  render_node(render_context& ctx, std::string& out, flag p_flag = flag::none):
+    m_ctx(ctx), m_out(out), m_flag(p_flag)
   {
   }
 
   template<typename T>
-  std::string operator()(const T& value) const {
-    if constexpr(std::is_same_v<T, long long> || std::is_same_v<T, int>) {
-      return std::to_string(value);
+  void operator()(const T& value) const {
+    if constexpr(std::is_same_v<T, int> || std::is_same_v<T, std::int64_t> ||
+        std::is_same_v<T, std::uint64_t>) {
+      append_integer(value, m_out);
     } else if constexpr(std::is_same_v<T, double>) {
-      std::stringstream ss;
-      ss << value;
-      return ss.str();
+      append_double(value, m_out);
     } else if constexpr(std::is_same_v<T, bool>) {
-      return value ? "true" : "false";
+      m_out += value ? "true" : "false";
     } else if constexpr(std::is_same_v<T, lambda>) {
-      std::string lambda_result = value([this](const mstch::node& n) {
-        return mstch::visit(render_node(m_ctx), n);
-      });
-      
-      // Let template_type handle the parsing - it will tokenize if it contains mustache tags
-      template_type interpreted{lambda_result};
-      auto rendered = render_context::push(m_ctx).render(interpreted);
-      return (m_flag == flag::escape_html) ? html_escape(rendered) : rendered;
+      auto renderer = [this](const mstch::node& n) {
+        std::string out;
+        mstch::visit(render_node(m_ctx, out), n);
+        return out;
+      };
+      if (value.takes_section()) {
+        // used as a variable there is no body, the result isn't parsed
+        auto result = value(renderer, section{m_ctx, nullptr, nullptr, {}, {}});
+        if (m_flag == flag::escape_html)
+          m_ctx.escape(result, m_out);
+        else
+          m_out += result;
+        return;
+      }
+      std::string lambda_result = value(renderer);
+
+      // results without tags render as they are, the rest are parsed as
+      // templates, repeated results come from the cache
+      if (lambda_result.find("{{") == std::string::npos) {
+        if (m_flag == flag::escape_html)
+          m_ctx.escape(lambda_result, m_out);
+        else
+          m_out += lambda_result;
+        return;
+      }
+      auto interpreted = lambda_cache::get(lambda_result, {"{{", "}}"});
+      if (m_flag == flag::escape_html) {
+        std::string rendered;
+        render_context::push(m_ctx).render(*interpreted, rendered);
+        m_ctx.escape(rendered, m_out);
+      } else {
+        render_context::push(m_ctx).render(*interpreted, m_out);
+      }
     } else if constexpr(std::is_same_v<T, std::string>) {
-      return (m_flag == flag::escape_html) ? html_escape(value) : value;
+      if (m_flag == flag::escape_html)
+        m_ctx.escape(value, m_out);
+      else
+        m_out += value;
+    } else if constexpr(std::is_same_v<T, string_view_node>) {
+      if (m_flag == flag::escape_html)
+        m_ctx.escape(value.view(), m_out);
+      else
+        m_out += value.view();
     }
-    return {};
   }
 
 private:
   render_context& m_ctx;
+  std::string& m_out;
   flag m_flag;
 };
 
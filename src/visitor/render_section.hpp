@@ -11,43 +11,95 @@ class render_section {
   enum class flag { none, keep_array };
   render_section(
       render_context& ctx,
-      const template_type& section,
-      const delim_type& delims,
+      std::string& out,
+      const mstch::node& node,
+      const instruction& section,
+      std::string_view prefix,
       flag p_flag = flag::none):
-      m_ctx(ctx), m_section(section), m_delims(delims), m_flag(p_flag)
+      m_ctx(ctx), m_out(out), m_node(node), m_section(section),
+      m_prefix(prefix), m_flag(p_flag)
   {
   }
 
   template<class T>
-  std::string operator()(const T& t) const {
-    return render_context::push(m_ctx, t).render(m_section);
+  void operator()(const T&) const {
+    render_context::push(m_ctx, m_node).render(
+        template_type::body(m_section), m_out, m_prefix);
   }
 
-  std::string operator()(const lambda& fun) const {
+  void operator()(const lambda& fun) const {
+    if (fun.takes_section()) {
+      // the lambda renders the compiled body itself, its result is final
+      auto body = template_type::body(m_section);
+      m_out += fun([this](const mstch::node& n) {
+        std::string out;
+        std::visit(render_node(m_ctx, out), n);
+        return out;
+      }, section{m_ctx, body.begin(), body.end(),
+          template_type::section_source(m_section.source()), m_prefix});
+      return;
+    }
     std::string section_str;
-    for (auto& token: m_section)
+    bool prev_eol = false;
+    auto& open = m_section.source();
+    for (auto& token: template_type::section_tokens(open)) {
+      if (prev_eol)
+        section_str += m_prefix;
       section_str += token.raw();
-    template_type interpreted{fun([this](const mstch::node& n) {
-      return std::visit(render_node(m_ctx), n);
-    }, section_str), m_delims};
-    return render_context::push(m_ctx).render(interpreted);
+      prev_eol = token.eol();
+    }
+    if (prev_eol)
+      section_str += m_prefix;
+    auto result = fun([this](const mstch::node& n) {
+      std::string out;
+      std::visit(render_node(m_ctx, out), n);
+      return out;
+    }, section_str);
+    auto delims = open.delims();
+    if (result.find(delims.first) == std::string::npos) {
+      m_out += result;
+      return;
+    }
+    render_context::push(m_ctx).render(
+        *lambda_cache::get(result, delims), m_out);
   }
 
-  std::string operator()(const array& array) const {
-    std::string out;
-    if (m_flag == flag::keep_array)
-      return render_context::push(m_ctx, array).render(m_section);
-    else
-      for (auto& item: array)
-        out += std::visit(render_section(
-            m_ctx, m_section, m_delims, flag::keep_array), item);
-    return out;
+  void operator()(const array& array) const {
+    render_items(array.data(), array.size());
+  }
+
+  void operator()(const arena_array& array) const {
+    render_items(array.begin(), array.size());
+  }
+
+  void operator()(const bound& value) const {
+    if (!value.sequence() || m_flag == flag::keep_array) {
+      render_context::push(m_ctx, m_node).render(
+          template_type::body(m_section), m_out, m_prefix);
+      return;
+    }
+    value.each([this](const mstch::node& item) {
+      std::visit(render_section(
+          m_ctx, m_out, item, m_section, m_prefix, flag::keep_array), item);
+    });
   }
 
  private:
+  void render_items(const mstch::node* items, std::size_t count) const {
+    if (m_flag == flag::keep_array)
+      render_context::push(m_ctx, m_node).render(
+          template_type::body(m_section), m_out, m_prefix);
+    else if (!m_ctx.render_parallel(items, count, m_section, m_out, m_prefix))
+      for (auto item = items; item != items + count; ++item)
+        std::visit(render_section(
+            m_ctx, m_out, *item, m_section, m_prefix, flag::keep_array), *item);
+  }
+
   render_context& m_ctx;
-  const template_type& m_section;
-  const delim_type& m_delims;
+  std::string& m_out;
+  const mstch::node& m_node;
+  const instruction& m_section;
+  std::string_view m_prefix;
   flag m_flag;
 };
 
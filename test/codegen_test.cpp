@@ -0,0 +1,101 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "mstch/mstch.hpp"
+#include "test/mstch_test_data.hpp"
+#include "_codegen_fixtures.hpp"
+#include "_codegen_partial_array.hpp"
+#include "_codegen_partial_array_of_partials.hpp"
+#include "_codegen_partial_array_of_partials_implicit.hpp"
+#include "_codegen_partial_comment.hpp"
+#include "_codegen_partial_comment_in_section.hpp"
+#include "_codegen_partial_empty.hpp"
+#include "_codegen_partial_in_section_lambda.hpp"
+#include "_codegen_partial_template.hpp"
+#include "_codegen_partial_view.hpp"
+#include "_codegen_partial_whitespace.hpp"
+#include "_codegen_section_functions_in_partials.hpp"
+#include "_codegen_section_lambda_in_partial.hpp"
+
+// The functions mstch_codegen generates from test/data have to render the
+// same as the interpreter.
+
+std::string load_file(std::string file_path) {
+  const std::ifstream input_stream(file_path.c_str());
+  std::stringstream buffer;
+  buffer << input_stream.rdbuf();
+  return buffer.str();
+}
+
+#define MSTCH_CODEGEN_TEST(x) TEST(CodegenTests, x) { \
+  const std::string expected = load_file("test/data/" #x ".txt"); \
+  EXPECT_EQ(expected, fixtures::render_ ## x(x ## _data)); \
+  std::string out; \
+  fixtures::render_ ## x(x ## _data, out); \
+  EXPECT_EQ(expected, out); \
+}
+
+MSTCH_CODEGEN_TEST(ampersand_escape)
+MSTCH_CODEGEN_TEST(apostrophe)
+MSTCH_CODEGEN_TEST(array_of_strings)
+MSTCH_CODEGEN_TEST(backslashes)
+MSTCH_CODEGEN_TEST(bug_11_eating_whitespace)
+MSTCH_CODEGEN_TEST(bug_length_property)
+MSTCH_CODEGEN_TEST(changing_delimiters)
+MSTCH_CODEGEN_TEST(comments)
+MSTCH_CODEGEN_TEST(complex)
+MSTCH_CODEGEN_TEST(context_lookup)
+MSTCH_CODEGEN_TEST(delimiters)
+MSTCH_CODEGEN_TEST(disappearing_whitespace)
+MSTCH_CODEGEN_TEST(dot_notation)
+MSTCH_CODEGEN_TEST(double_render)
+MSTCH_CODEGEN_TEST(empty_list)
+MSTCH_CODEGEN_TEST(empty_sections)
+MSTCH_CODEGEN_TEST(empty_string)
+MSTCH_CODEGEN_TEST(empty_template)
+MSTCH_CODEGEN_TEST(error_eof_in_section)
+MSTCH_CODEGEN_TEST(error_eof_in_tag)
+MSTCH_CODEGEN_TEST(error_not_found)
+MSTCH_CODEGEN_TEST(escaped)
+MSTCH_CODEGEN_TEST(falsy)
+MSTCH_CODEGEN_TEST(falsy_array)
+MSTCH_CODEGEN_TEST(grandparent_context)
+MSTCH_CODEGEN_TEST(higher_order_sections)
+MSTCH_CODEGEN_TEST(implicit_iterator)
+MSTCH_CODEGEN_TEST(included_tag)
+MSTCH_CODEGEN_TEST(inverted_section)
+MSTCH_CODEGEN_TEST(keys_with_questionmarks)
+MSTCH_CODEGEN_TEST(multiline_comment)
+MSTCH_CODEGEN_TEST(nested_dot)
+MSTCH_CODEGEN_TEST(nested_higher_order_sections)
+MSTCH_CODEGEN_TEST(nested_iterating)
+MSTCH_CODEGEN_TEST(nesting)
+MSTCH_CODEGEN_TEST(nesting_same_name)
+MSTCH_CODEGEN_TEST(null_lookup_array)
+MSTCH_CODEGEN_TEST(null_lookup_object)
+MSTCH_CODEGEN_TEST(null_string)
+MSTCH_CODEGEN_TEST(null_view)
+MSTCH_CODEGEN_TEST(partial_array)
+MSTCH_CODEGEN_TEST(partial_array_of_partials)
+MSTCH_CODEGEN_TEST(partial_array_of_partials_implicit)
+MSTCH_CODEGEN_TEST(partial_comment)
+MSTCH_CODEGEN_TEST(partial_comment_in_section)
+MSTCH_CODEGEN_TEST(partial_empty)
+MSTCH_CODEGEN_TEST(partial_in_section_lambda)
+MSTCH_CODEGEN_TEST(partial_template)
+MSTCH_CODEGEN_TEST(partial_view)
+MSTCH_CODEGEN_TEST(partial_whitespace)
+MSTCH_CODEGEN_TEST(recursion_with_same_names)
+MSTCH_CODEGEN_TEST(reuse_of_enumerables)
+MSTCH_CODEGEN_TEST(section_as_context)
+MSTCH_CODEGEN_TEST(section_functions_in_partials)
+MSTCH_CODEGEN_TEST(section_lambda_in_partial)
+MSTCH_CODEGEN_TEST(simple)
+MSTCH_CODEGEN_TEST(string_as_context)
+MSTCH_CODEGEN_TEST(two_in_a_row)
+MSTCH_CODEGEN_TEST(two_sections)
+MSTCH_CODEGEN_TEST(unescaped)
+MSTCH_CODEGEN_TEST(whitespace)
+MSTCH_CODEGEN_TEST(zero_view)
@@ -0,0 +1 @@
+const auto partial_comment_data = mstch::map{};
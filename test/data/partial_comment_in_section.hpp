@@ -0,0 +1,3 @@
+const auto partial_comment_in_section_data = mstch::map{
+  {"list", mstch::array{1, 2}}
+};
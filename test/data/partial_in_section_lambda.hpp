@@ -0,0 +1,6 @@
+const mstch::node partial_in_section_lambda_data = mstch::map{
+  {"x", std::string{"x"}},
+  {"wrap", mstch::lambda{[](const mstch::section& body) -> mstch::node {
+    return "(" + body.render() + ")";
+  }}}
+};
@@ -0,0 +1,6 @@
+const mstch::node section_lambda_in_partial_data = mstch::map{
+  {"name", std::string{"<x>"}},
+  {"twice", mstch::lambda{[](const mstch::section& body) -> mstch::node {
+    return body.render() + body.render();
+  }}}
+};
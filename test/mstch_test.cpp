@@ -1,10 +1,14 @@
 #include <cassert>
+#include <list>
+#include <thread>
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 #include "string"
 
 #include <gtest/gtest.h>
 #include "mstch/mstch.hpp"
+#include "mstch/static_template.hpp"
 #include "test/mstch_test_data.hpp"
 
 
@@ -19,6 +23,14 @@ std::string load_file(std::string file_path) {
   const std::string expected = load_file("test/data/" #x ".txt"); \
   const std::string tmpl = load_file("test/data/" #x ".mustache"); \
   EXPECT_EQ(expected, mstch::render(tmpl, x ## _data)); \
+  const mstch::compiled_template compiled{tmpl}; \
+  EXPECT_EQ(expected, mstch::render(compiled, x ## _data)); \
+  EXPECT_EQ(expected, mstch::render(compiled, x ## _data)); \
+  std::ostringstream stream; \
+  mstch::render(compiled, x ## _data, stream); \
+  EXPECT_EQ(expected, stream.str()); \
+  const mstch::template_loader loader{"test/data"}; \
+  EXPECT_EQ(expected, mstch::render(loader.get(#x), x ## _data)); \
 }
 
 #define MSTCH_PARTIAL_TEST(x) TEST(MstchTests, x) { \
@@ -26,6 +38,12 @@ std::string load_file(std::string file_path) {
   const std::string tmpl = load_file("test/data/" #x ".mustache"); \
   const std::string partial = load_file("test/data/" #x ".partial"); \
   EXPECT_EQ(expected, mstch::render(tmpl, x ## _data, {{"partial", partial}})); \
+  const mstch::compiled_template compiled{tmpl, {{"partial", partial}}}; \
+  EXPECT_EQ(expected, mstch::render(compiled, x ## _data)); \
+  EXPECT_EQ(expected, mstch::render(compiled, x ## _data)); \
+  std::ostringstream stream; \
+  mstch::render(compiled, x ## _data, stream); \
+  EXPECT_EQ(expected, stream.str()); \
 }
 
 MSTCH_TEST(ampersand_escape)
@@ -71,7 +89,10 @@ MSTCH_TEST(null_view)
 MSTCH_PARTIAL_TEST(partial_array)
 MSTCH_PARTIAL_TEST(partial_array_of_partials)
 MSTCH_PARTIAL_TEST(partial_array_of_partials_implicit)
+MSTCH_PARTIAL_TEST(partial_comment)
+MSTCH_PARTIAL_TEST(partial_comment_in_section)
 MSTCH_PARTIAL_TEST(partial_empty)
+MSTCH_PARTIAL_TEST(partial_in_section_lambda)
 MSTCH_PARTIAL_TEST(partial_template)
 MSTCH_PARTIAL_TEST(partial_view)
 MSTCH_PARTIAL_TEST(partial_whitespace)
@@ -79,6 +100,7 @@ MSTCH_TEST(recursion_with_same_names)
 MSTCH_TEST(reuse_of_enumerables)
 MSTCH_TEST(section_as_context)
 MSTCH_PARTIAL_TEST(section_functions_in_partials)
+MSTCH_PARTIAL_TEST(section_lambda_in_partial)
 MSTCH_TEST(simple)
 MSTCH_TEST(string_as_context)
 MSTCH_TEST(two_in_a_row)
@@ -86,3 +108,535 @@ MSTCH_TEST(two_sections)
 MSTCH_TEST(unescaped)
 MSTCH_TEST(whitespace)
 MSTCH_TEST(zero_view)
+
+TEST(MstchTests, append_to_string) {
+  std::string out{"<"};
+  mstch::render(mstch::compiled_template{"{{a}}"}, mstch::map{{"a", 1}}, out);
+  EXPECT_EQ("<1", out);
+}
+
+TEST(MstchTests, stream_chunks) {
+  mstch::array items(2000, std::string{"item"});
+  const mstch::compiled_template tmpl{"{{#items}}<li>{{.}}</li>\n{{/items}}"};
+  std::string expected = mstch::render(tmpl, mstch::map{{"items", items}});
+  std::string streamed;
+  int chunks = 0;
+  mstch::render(tmpl, mstch::map{{"items", items}},
+      [&](const char* data, std::size_t size) {
+        streamed.append(data, size);
+        ++chunks;
+      });
+  EXPECT_EQ(expected, streamed);
+  EXPECT_GT(chunks, 1);
+}
+
+TEST(MstchTests, custom_escape) {
+  const mstch::compiled_template tmpl{"{{a}}", {},
+      [](const std::string& str) { return "[" + str + "]"; }};
+  EXPECT_EQ("[<]", mstch::render(tmpl, mstch::map{{"a", std::string{"<"}}}));
+}
+
+TEST(MstchTests, concurrent_render) {
+  const std::string expected = load_file("test/data/complex.txt");
+  const mstch::compiled_template tmpl{load_file("test/data/complex.mustache")};
+  std::vector<std::thread> threads;
+  std::vector<int> failures(8, 0);
+  for (std::size_t i = 0; i < failures.size(); ++i)
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 200; ++j)
+        if (mstch::render(tmpl, complex_data) != expected)
+          failures[i]++;
+    });
+  for (auto& thread: threads)
+    thread.join();
+  for (auto failed: failures)
+    EXPECT_EQ(0, failed);
+}
+
+TEST(MstchTests, flat_map) {
+  mstch::flat_map view{
+      {"name", std::string{"Chris"}},
+      {"items", mstch::array{mstch::flat_map{{"id", 1}}, mstch::flat_map{{"id", 2}}}}};
+  for (int i = 0; i < 100; ++i)
+    view["key" + std::to_string(i)] = i;
+  EXPECT_FALSE(view.insert({"name", std::string{"Mark"}}).second);
+  EXPECT_EQ(102u, view.size());
+  EXPECT_EQ(1u, view.count("key99"));
+  EXPECT_EQ(0u, view.count("key100"));
+  EXPECT_EQ("name", view.begin()->first);
+  EXPECT_EQ("key99", (view.end() - 1)->first);
+  EXPECT_EQ("Chris 1,2, 42",
+      mstch::render("{{name}} {{#items}}{{id}},{{/items}} {{key42}}", view));
+}
+
+TEST(MstchTests, escape_long_text) {
+  std::string text, expected;
+  for (int i = 0; i < 500; ++i) {
+    text += "plain text & <tag attr=\"'value'\"/> " + std::to_string(i);
+    expected += "plain text &amp; &lt;tag attr=&quot;&#39;value&#39;&quot;&#x2F;&gt; " +
+        std::to_string(i);
+  }
+  EXPECT_EQ(expected, mstch::render("{{text}}", mstch::map{{"text", text}}));
+  EXPECT_EQ(text, mstch::render("{{{text}}}", mstch::map{{"text", text}}));
+}
+
+TEST(MstchTests, numbers) {
+  mstch::map view{
+      {"int", -42},
+      {"int64", std::int64_t{-9223372036854775807LL - 1}},
+      {"uint64", std::uint64_t{18446744073709551615ULL}},
+      {"zero", std::uint64_t{0}},
+      {"double", 0.1 + 0.2}};
+  EXPECT_EQ("-42 -9223372036854775808 18446744073709551615 0.30000000000000004",
+      mstch::render("{{int}} {{int64}} {{uint64}} {{double}}", view));
+  EXPECT_EQ("empty", mstch::render("{{#zero}}set{{/zero}}{{^zero}}empty{{/zero}}", view));
+}
+
+TEST(MstchTests, partial_registry) {
+  const mstch::partial_registry partials{
+      {"tree", "{{name}}{{#kids}}({{> tree}}){{/kids}}"},
+      {"unused", "{{#broken}}"}};
+  const mstch::compiled_template tree{"{{> tree}}", partials};
+  const mstch::compiled_template list{"{{#trees}}{{> tree}};{{/trees}}{{> missing}}", partials};
+  mstch::map leaf{{"name", std::string{"c"}}, {"kids", mstch::array{}}};
+  mstch::map root{{"name", std::string{"a"}}, {"kids", mstch::array{
+      mstch::map{{"name", std::string{"b"}}, {"kids", mstch::array{leaf}}}, leaf}}};
+  EXPECT_EQ("a(b(c))(c)", mstch::render(tree, root));
+  EXPECT_EQ("a(b(c))(c);c;", mstch::render(list, mstch::map{{"trees", mstch::array{root, leaf}}}));
+}
+
+TEST(MstchTests, partial_registry_concurrent_first_use) {
+  const mstch::partial_registry partials{{"row", "<{{.}}>"}};
+  const mstch::compiled_template tmpl{"{{#rows}}{{> row}}{{/rows}}", partials};
+  const mstch::node view = mstch::map{{"rows", mstch::array{1, 2, 3}}};
+  std::vector<std::thread> threads;
+  std::vector<std::string> results(8);
+  for (std::size_t i = 0; i < results.size(); ++i)
+    threads.emplace_back([&, i] { results[i] = mstch::render(tmpl, view); });
+  for (auto& thread: threads)
+    thread.join();
+  for (auto& result: results)
+    EXPECT_EQ("<1><2><3>", result);
+}
+
+TEST(MstchTests, template_loader) {
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "mstch_template_loader";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  auto write = [&dir](const std::string& name, const std::string& text) {
+    const auto path = dir / (name + ".mustache");
+    const bool existed = fs::exists(path);
+    const auto written = existed ? fs::last_write_time(path) : fs::file_time_type{};
+    std::ofstream(path) << text;
+    if (existed)
+      fs::last_write_time(path, written + std::chrono::seconds(1));
+  };
+  write("page", "<{{> item}}{{> missing}}>");
+  write("item", "{{name}}{{#kids}}[{{> item}}]{{/kids}}");
+  const mstch::node view = mstch::map{
+      {"name", std::string{"a"}},
+      {"kids", mstch::array{mstch::map{
+          {"name", std::string{"b"}}, {"kids", mstch::array{}}}}}};
+
+  const mstch::template_loader loader{dir.string()};
+  const auto page = loader.get("page");
+  EXPECT_EQ("<a[b]>", mstch::render(page, view));
+  EXPECT_EQ("a[b]", mstch::render(loader.get("item"), view));
+  EXPECT_THROW(loader.get("missing"), std::runtime_error);
+
+  write("other", "{{name}}");
+  EXPECT_EQ("a", mstch::render(loader.get("other"), view));
+
+  write("item", "{{name}}!");
+  write("missing", "?");
+  // changed without a new modification time, other stays cached
+  const auto other = dir / "other.mustache";
+  const auto other_time = fs::last_write_time(other);
+  std::ofstream(other) << "{{name}}{{name}}";
+  fs::last_write_time(other, other_time);
+  EXPECT_EQ("<a!?>", mstch::render(loader.get("page"), view));
+  EXPECT_EQ("<a[b]>", mstch::render(page, view));
+  EXPECT_EQ("a", mstch::render(loader.get("other"), view));
+  fs::remove_all(dir);
+}
+
+TEST(MstchTests, parallel_sections) {
+  mstch::array rows;
+  for (int i = 0; i < 1000; ++i)
+    rows.push_back(mstch::map{
+        {"id", i},
+        {"name", std::string{"<row>"}},
+        {"tags", mstch::array{std::string{"a"}, std::string{"b"}}},
+        {"empty", i % 3 == 0}});
+  const mstch::node view = mstch::map{
+      {"rows", rows}, {"title", std::string{"Rows"}}};
+  const mstch::partial_registry partials{
+      {"row", "{{#rows}}\n  {{id}}:{{name}}{{#tags}}[{{.}}]{{/tags}}\n"
+          "{{^empty}}  {{title}}\n{{/empty}}{{/rows}}\n"}};
+  const mstch::compiled_template tmpl{"<{{title}}>\n  {{> row}}\nend", partials};
+  mstch::thread_pool pool{4};
+  const auto expected = mstch::render(tmpl, view);
+  EXPECT_EQ(expected, mstch::render(tmpl.parallel(pool, 2), view));
+  EXPECT_EQ(expected, mstch::render(tmpl.parallel(pool, 1000), view));
+  std::ostringstream stream;
+  mstch::render(tmpl.parallel(pool, 2), view, stream);
+  EXPECT_EQ(expected, stream.str());
+}
+
+TEST(MstchTests, render_batch) {
+  const mstch::compiled_template tmpl{
+      "Dear {{name}},\n{{#items}}- {{.}}\n{{/items}}"};
+  std::vector<mstch::node> roots;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; ++i) {
+    roots.push_back(mstch::map{
+        {"name", "user" + std::to_string(i)},
+        {"items", mstch::array(i % 4, i)}});
+    expected.push_back(mstch::render(tmpl, roots.back()));
+  }
+  mstch::thread_pool pool{3};
+  EXPECT_EQ(expected, mstch::render_batch(tmpl, roots, pool));
+  EXPECT_EQ(expected, mstch::render_batch(tmpl, roots, 2));
+  EXPECT_TRUE(mstch::render_batch(tmpl, roots.data(), 0, pool).empty());
+
+  std::vector<std::string> sunk(roots.size());
+  mstch::render_batch(tmpl, roots.data(), roots.size(), pool,
+      [&sunk](std::size_t index, const char* data, std::size_t size) {
+        sunk[index].assign(data, size);
+      });
+  EXPECT_EQ(expected, sunk);
+}
+
+TEST(MstchTests, arena) {
+  const std::string tmpl{
+      "{{title}} {{{title}}}\n{{#rows}}{{id}}:{{name}}{{#tags}}[{{.}}]{{/tags}}\n"
+      "{{/rows}}{{^empty}}none{{/empty}}{{#nested.inner}}{{value}}{{/nested.inner}}"
+      "{{upper}}"};
+  const mstch::lambda upper{[]() -> mstch::node { return std::string{"UP"}; }};
+  mstch::array rows;
+  for (int i = 0; i < 3; ++i)
+    rows.push_back(mstch::map{
+        {"id", i},
+        {"name", "row" + std::to_string(i)},
+        {"tags", mstch::array{std::string{"a"}, std::string{"b"}}}});
+  const mstch::node heap = mstch::map{
+      {"title", std::string{"<Rows>"}},
+      {"rows", rows},
+      {"empty", mstch::array{}},
+      {"nested", mstch::map{{"inner", mstch::map{{"value", 42}}}}},
+      {"upper", upper}};
+  const auto expected = mstch::render(tmpl, heap);
+
+  auto counted = std::make_shared<int>(0);
+  {
+    mstch::arena arena{256};
+    auto row = [&](int i) {
+      return arena.map({
+          {"id", i},
+          {"name", arena.string("row" + std::to_string(i))},
+          {"tags", arena.array({arena.string("a"), std::string{"b"}})}});
+    };
+    const mstch::node view = arena.map({
+        {"title", arena.string("<Rows>")},
+        {"rows", arena.array(3, row)},
+        {"empty", arena.array({})},
+        {"nested", mstch::map{{"inner", mstch::map{{"value", 42}}}}},
+        {"upper", mstch::lambda{[counted]() -> mstch::node {
+          return std::string{"UP"};
+        }}}});
+    EXPECT_EQ(expected, mstch::render(tmpl, view));
+    EXPECT_EQ(expected, mstch::render(tmpl, arena.copy(heap)));
+    EXPECT_EQ(2, counted.use_count());
+  }
+  EXPECT_EQ(1, counted.use_count());
+}
+
+TEST(MstchTests, lambda_cache) {
+  const mstch::node view = mstch::map{
+      {"items", mstch::array{1, 2, 3}},
+      {"name", std::string{"<x>"}},
+      {"plain", mstch::lambda{[]() -> mstch::node {
+        return std::string{"a < b"};
+      }}},
+      {"tagged", mstch::lambda{[]() -> mstch::node {
+        return std::string{"[{{name}}]"};
+      }}},
+      {"wrap", mstch::lambda{[](const std::string& text) -> mstch::node {
+        return "(" + text + ")";
+      }}}};
+  const std::string tmpl{
+      "{{#items}}{{plain}}|{{{plain}}}|{{tagged}}|{{{tagged}}}|"
+      "{{#wrap}}{{name}}{{/wrap}}{{#wrap}}text{{/wrap}}\n{{/items}}"
+      "{{=<% %>=}}<%#wrap%>{{name}}<%name%><%/wrap%>"};
+  const std::string expected{
+      "a &lt; b|a < b|[&amp;lt;x&amp;gt;]|[&lt;x&gt;]|(&lt;x&gt;)(text)\n"
+      "a &lt; b|a < b|[&amp;lt;x&amp;gt;]|[&lt;x&gt;]|(&lt;x&gt;)(text)\n"
+      "a &lt; b|a < b|[&amp;lt;x&amp;gt;]|[&lt;x&gt;]|(&lt;x&gt;)(text)\n"
+      "({{name}}&lt;x&gt;)"};
+  EXPECT_EQ(expected, mstch::render(tmpl, view));
+  EXPECT_EQ(expected, mstch::render(tmpl, view));
+
+  std::size_t size = mstch::config::lambda_cache_size;
+  mstch::config::lambda_cache_size = 0;
+  EXPECT_EQ(expected, mstch::render(tmpl, view));
+  mstch::config::lambda_cache_size = 1;
+  EXPECT_EQ(expected, mstch::render(tmpl, view));
+  mstch::config::lambda_cache_size = size;
+}
+
+TEST(MstchTests, section_lambda) {
+  std::vector<std::string> sources;
+  const mstch::node view = mstch::map{
+      {"name", std::string{"<x>"}},
+      {"twice", mstch::lambda{[&sources](const mstch::section& body) -> mstch::node {
+        sources.emplace_back(body.source());
+        return body.render() + body.render();
+      }}},
+      {"as_user", mstch::lambda{[](const mstch::section& body) -> mstch::node {
+        mstch::node user = mstch::map{{"name", std::string{"bob"}}};
+        return "[" + body.render(user) + "]";
+      }}}};
+
+  EXPECT_EQ("&lt;x&gt;!&lt;x&gt;!", mstch::render(
+      "{{#twice}}{{name}}!{{/twice}}{{twice}}", view));
+  ASSERT_EQ(2u, sources.size());
+  EXPECT_EQ("{{name}}!", sources[0]);
+  EXPECT_EQ("", sources[1]);
+
+  EXPECT_EQ("[bob][][{{name}}bob]&lt;x&gt;", mstch::render(
+      "{{#as_user}}{{name}}{{/as_user}}{{#as_user}}{{/as_user}}"
+      "{{=<% %>=}}<%#as_user%>{{name}}<%name%><%/as_user%><%name%>", view));
+
+  EXPECT_EQ("  a &lt;x&gt;\n  a &lt;x&gt;\n  end\n", mstch::render(
+      "  {{>partial}}\n", view,
+      {{"partial", "{{#twice}}\na {{name}}\n{{/twice}}\nend\n"}}));
+}
+
+class memoized_object: public mstch::object {
+ public:
+  memoized_object() {
+    register_methods(this, {{"never", &memoized_object::never}});
+    register_methods(this, {{"render", &memoized_object::render}},
+        mstch::memoize::per_render);
+    m_object_slot = register_method("object", this, &memoized_object::object,
+        mstch::memoize::per_object);
+    register_methods(this, {{"doubled", &memoized_object::doubled}},
+        mstch::memoize::per_object);
+  }
+
+  mstch::node never() { return ++calls[0]; }
+  mstch::node render() { return ++calls[1]; }
+  mstch::node object() { return ++calls[2]; }
+  // a memoized method using another one of the same object
+  mstch::node doubled() { return 2 * std::get<int>(at("object")); }
+
+  int calls[3] = {0, 0, 0};
+  std::size_t m_object_slot;
+};
+
+TEST(MstchTests, object_memoization) {
+  auto object = std::make_shared<memoized_object>();
+  const mstch::node view = mstch::map{
+      {"o", object}, {"items", mstch::array{1, 2}}};
+  const std::string tmpl{
+      "{{#items}}{{o.never}}{{o.render}}{{o.object}}|{{/items}}"
+      "{{#o}}{{never}}{{render}}{{object}}{{/o}}"};
+
+  EXPECT_EQ("111|211|311", mstch::render(tmpl, view));
+  EXPECT_EQ("421|521|621", mstch::render(tmpl, view));
+  EXPECT_EQ(6, object->calls[0]);
+  EXPECT_EQ(2, object->calls[1]);
+  EXPECT_EQ(1, object->calls[2]);
+
+  EXPECT_EQ(object->m_object_slot, object->slot("object"));
+  EXPECT_EQ(mstch::object::npos, object->slot("missing"));
+  EXPECT_EQ(mstch::memoize::per_render, object->policy(object->slot("render")));
+  EXPECT_EQ(1, std::get<int>(object->at("object")));
+  EXPECT_EQ(7, std::get<int>(object->at("never")));
+  EXPECT_THROW(object->at("missing"), std::out_of_range);
+  EXPECT_EQ("2", mstch::render("{{o.doubled}}", view));
+  EXPECT_EQ(1, object->calls[2]);
+}
+
+TEST(MstchTests, lookup_cache) {
+  mstch::array items;
+  for (int i = 0; i < 4; ++i)
+    items.push_back(mstch::flat_map{
+        {"id", i}, {"name", "n" + std::to_string(i)}});
+  // a differently shaped item has id and name at other positions
+  items.push_back(mstch::flat_map{{"name", std::string{"last"}}, {"id", 4}});
+  const mstch::node view = mstch::flat_map{
+      {"title", std::string{"t"}}, {"items", items}};
+  mstch::compiled_template compiled{
+      "{{#items}}{{id}}:{{name}}:{{title}} {{/items}}"};
+  const std::string expected{"0:n0:t 1:n1:t 2:n2:t 3:n3:t 4:last:t "};
+
+  EXPECT_EQ(expected, mstch::render(compiled, view));
+  auto first = compiled.lookups();
+  // items, the first id, name and title, the last id and name
+  EXPECT_EQ(6u, first.misses);
+  EXPECT_EQ(10u, first.hits);
+
+  // id and name now miss on the first and on the last item
+  EXPECT_EQ(expected, mstch::render(compiled, view));
+  auto second = compiled.lookups();
+  EXPECT_EQ(first.misses + 4, second.misses);
+  EXPECT_EQ(first.hits + 12, second.hits);
+
+  // maps have no positions to remember, their lookups aren't counted, and
+  // neither are names that aren't found
+  const mstch::node map_view = mstch::map{{"title", std::string{"t"}}};
+  mstch::compiled_template map_compiled{"{{title}}{{title}}{{missing}}"};
+  EXPECT_EQ("tt", mstch::render(map_compiled, map_view));
+  EXPECT_EQ(0u, map_compiled.lookups().hits);
+  EXPECT_EQ(0u, map_compiled.lookups().misses);
+}
+
+namespace {
+
+constexpr char static_text[] = "plain text\nno tags";
+constexpr char static_variables[] =
+    "{{name}} {{{name}}} {{&name}} {{ name }} {{user.name}} {{missing}}!";
+constexpr char static_sections[] =
+    "<ul>\n"
+    "  {{#items}}\n"
+    "  <li>{{id}}: {{name}}{{#tags}} [{{.}}]{{/tags}}</li>\n"
+    "  {{/items}}\n"
+    "  {{^items}}\n"
+    "  <li>none</li>\n"
+    "  {{/items}}\n"
+    "</ul>\n"
+    "{{! a comment }}\n"
+    "{{#user}}{{name}} of {{title}}{{/user}}\n"
+    "{{^empty}}nothing{{/empty}}{{#empty}}never{{/empty}}";
+constexpr char static_delimiters[] =
+    "{{=<% %>=}}\n<% name %> {{name}}\n<%={{ }}=%>\n{{name}}";
+constexpr char static_lambdas[] =
+    "{{upper}} {{#wrap}}{{name}}{{/wrap}} {{#twice}}{{name}} {{/twice}}"
+    "{{#items}}{{#wrap}}{{id}}{{/wrap}}{{/items}}";
+
+template<const char* Source>
+void expect_static(const mstch::node& view) {
+  mstch::static_template<Source> tmplt;
+  EXPECT_EQ(mstch::render(std::string{Source}, view), mstch::render(tmplt, view));
+}
+
+}
+
+TEST(MstchTests, static_template) {
+  mstch::array items;
+  for (int i = 0; i < 3; ++i)
+    items.push_back(mstch::map{
+        {"id", i},
+        {"name", "<" + std::to_string(i) + ">"},
+        {"tags", mstch::array{std::string{"a"}, std::string{"b"}}}});
+  const mstch::node view = mstch::map{
+      {"name", std::string{"<b>"}},
+      {"title", std::string{"root"}},
+      {"user", mstch::map{{"name", std::string{"ann"}}}},
+      {"items", items},
+      {"empty", mstch::array{}},
+      {"upper", mstch::lambda{[]() -> mstch::node {
+        return std::string{"{{title}}"};
+      }}},
+      {"wrap", mstch::lambda{[](const std::string& text) -> mstch::node {
+        return "(" + text + ")";
+      }}},
+      {"twice", mstch::lambda{[](const mstch::section& body) -> mstch::node {
+        return body.render() + body.render();
+      }}}};
+
+  expect_static<static_text>(view);
+  expect_static<static_variables>(view);
+  expect_static<static_sections>(view);
+  expect_static<static_sections>(mstch::map{{"items", mstch::array{}}});
+  expect_static<static_delimiters>(view);
+  expect_static<static_lambdas>(view);
+
+  mstch::static_template<static_variables> tmplt;
+  EXPECT_EQ("&lt;b&gt; <b> <b> &lt;b&gt; ann !", mstch::render(tmplt, view));
+}
+
+namespace {
+
+struct bound_order {
+  int id;
+  double total;
+  std::vector<std::string> items;
+};
+
+struct bound_user {
+  std::string name;
+  bool admin;
+  std::uint64_t visits;
+  bound_order last;
+  std::vector<bound_order> orders;
+  std::list<int> scores;
+  std::vector<bound_order> returns;
+  const std::string& display_name() const { return name; }
+  std::string greeting() const { return "hi " + name; }
+  std::uint64_t visit_count() const noexcept { return visits; }
+};
+
+constexpr char static_bound[] =
+    "{{name}}{{#orders}} {{id}}={{total}}{{/orders}}{{^returns}} none{{/returns}}";
+
+}
+
+MSTCH_BIND(bound_order, MSTCH_FIELD(id), MSTCH_FIELD(total), MSTCH_FIELD(items))
+
+template<>
+struct mstch::binding<bound_user> {
+  static constexpr mstch::binding_field fields[] = {
+      mstch::field<&bound_user::name>("name"),
+      mstch::field<&bound_user::admin>("admin"),
+      mstch::field<&bound_user::visits>("visits"),
+      mstch::field<&bound_user::last>("last"),
+      mstch::field<&bound_user::orders>("orders"),
+      mstch::field<&bound_user::scores>("scores"),
+      mstch::field<&bound_user::returns>("returns"),
+      mstch::field<&bound_user::display_name>("display"),
+      mstch::field<&bound_user::greeting>("greeting"),
+      mstch::field<&bound_user::visit_count>("visit_count")};
+};
+
+TEST(MstchTests, bound_structs) {
+  bound_user user{"<ann>", true, 7, {1, 2.5, {"a"}},
+      {{2, 10, {"b", "c"}}, {3, 0.5, {}}}, {4, 5}, {}};
+  const mstch::node view = mstch::bind(user);
+
+  EXPECT_EQ("<ann> &lt;ann&gt; true 7 1 a",
+      mstch::render("{{{name}}} {{display}} {{admin}} {{visits}} "
+          "{{last.id}} {{#last}}{{#items}}{{.}}{{/items}}{{/last}}", view));
+  EXPECT_EQ("2:10[bc] 3:0.5[] ",
+      mstch::render("{{#orders}}{{id}}:{{total}}"
+          "[{{#items}}{{.}}{{/items}}] {{/orders}}", view));
+  EXPECT_EQ("45|none|hi &lt;ann&gt;||",
+      mstch::render("{{#scores}}{{.}}{{/scores}}|{{^returns}}none{{/returns}}"
+          "{{#returns}}x{{/returns}}|{{greeting}}|{{missing}}{{last.missing}}|",
+          view));
+  EXPECT_EQ("7", mstch::render("{{visit_count}}", view));
+
+  // strings are read as views of the struct's own characters
+  auto& bound = std::get<mstch::bound>(view);
+  auto name = bound.field(bound.slot("name"));
+  ASSERT_TRUE(std::holds_alternative<mstch::string_view_node>(name));
+  EXPECT_EQ(user.name.data(),
+      std::get<mstch::string_view_node>(name).view().data());
+
+  // bound values mix with ordinary nodes and are found through the scope
+  const mstch::node mixed = mstch::map{
+      {"user", mstch::bind(user)}, {"title", std::string{"t"}}};
+  mstch::compiled_template compiled{
+      "{{#user}}{{#orders}}{{name}}/{{title}}/{{id}} {{/orders}}{{/user}}"};
+  EXPECT_EQ("&lt;ann&gt;/t/2 &lt;ann&gt;/t/3 ", mstch::render(compiled, mixed));
+
+  // changes to the struct show up without binding it again
+  user.orders[0].id = 8;
+  EXPECT_EQ("&lt;ann&gt;/t/8 &lt;ann&gt;/t/3 ", mstch::render(compiled, mixed));
+
+  mstch::static_template<static_bound> tmplt;
+  EXPECT_EQ(mstch::render(std::string{static_bound}, view),
+      mstch::render(tmplt, view));
+}
@@ -43,7 +43,10 @@
 #include "test/data/partial_array.hpp"
 #include "test/data/partial_array_of_partials.hpp"
 #include "test/data/partial_array_of_partials_implicit.hpp"
+#include "test/data/partial_comment.hpp"
+#include "test/data/partial_comment_in_section.hpp"
 #include "test/data/partial_empty.hpp"
+#include "test/data/partial_in_section_lambda.hpp"
 #include "test/data/partial_template.hpp"
 #include "test/data/partial_view.hpp"
 #include "test/data/partial_whitespace.hpp"
@@ -51,6 +54,7 @@
 #include "test/data/reuse_of_enumerables.hpp"
 #include "test/data/section_as_context.hpp"
 #include "test/data/section_functions_in_partials.hpp"
+#include "test/data/section_lambda_in_partial.hpp"
 #include "test/data/simple.hpp"
 #include "test/data/specs_lambdas.hpp"
 #include "test/data/string_as_context.hpp"
@@ -0,0 +1,364 @@
+// Generates C++ render functions from mustache templates.
+//
+//   mstch_codegen --header out.hpp --source out.cpp [--include path]
+//       [--namespace ns] [--partial name=file]... template...
+//
+// Every template becomes a function render_<stem> declared in the header,
+// two templates with the same stem are an error.
+// Templates are parsed by template_type, so the generated code renders
+// exactly what the interpreter renders: text is appended as literals,
+// sections become functions called once per item, and partial tags call the
+// partial's function directly. Partials that weren't given render nothing.
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "template_type.hpp"
+
+using namespace mstch;
+
+namespace {
+
+std::string load_file(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input)
+    throw std::runtime_error("can't read " + path);
+  std::ostringstream buffer;
+  buffer << input.rdbuf();
+  return buffer.str();
+}
+
+std::string stem(const std::string& path) {
+  auto begin = path.find_last_of("/\\");
+  begin = begin == std::string::npos ? 0 : begin + 1;
+  auto end = path.find('.', begin);
+  std::string name = path.substr(begin, end - begin);
+  for (auto& c: name)
+    if (!std::isalnum(static_cast<unsigned char>(c)))
+      c = '_';
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+    name.insert(0, "_");
+  return name;
+}
+
+// a string_view expression for str, octal escapes keep it safe for any byte
+std::string literal(std::string_view str) {
+  std::string out = "std::string_view{\"";
+  for (unsigned char c: str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c < 0x20 || c >= 0x7f || c == '?') {
+      char escaped[5];
+      std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+      out += escaped;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out + "\", " + std::to_string(str.size()) + "}";
+}
+
+class generator {
+ public:
+  void add_partial(const std::string& name, const std::string& path) {
+    m_partials[name] = add(path);
+  }
+
+  // templates whose files have the same stem would get the same function
+  void add_template(const std::string& path) {
+    auto name = stem(path);
+    for (auto& exported: m_exported)
+      if (exported.first == name)
+        throw std::runtime_error("both " + m_units[exported.second].path +
+            " and " + path + " would generate render_" + name);
+    m_exported.push_back({name, add(path)});
+  }
+
+  void write(std::ostream& header, std::ostream& source,
+      const std::string& include, const std::string& ns) const;
+
+ private:
+  struct unit {
+    std::string path;
+    std::string source;
+    std::unique_ptr<template_type> tmpl;
+  };
+  std::vector<unit> m_units;
+  std::map<std::string, std::size_t> m_partials;
+  std::vector<std::pair<std::string, std::size_t>> m_exported;
+
+  std::size_t add(const std::string& path) {
+    for (std::size_t i = 0; i < m_units.size(); ++i)
+      if (m_units[i].path == path)
+        return i;
+    auto source = load_file(path);
+    auto tmpl = std::make_unique<template_type>(source);
+    m_units.push_back({path, std::move(source), std::move(tmpl)});
+    return m_units.size() - 1;
+  }
+};
+
+// Emits the functions of one template. Each section gets a body function,
+// a text function for lambdas and a static_section tying them together.
+class unit_writer {
+ public:
+  unit_writer(std::ostream& out, const std::string& id,
+      const std::map<std::string, std::string>& partials):
+      m_out(out), m_id(id), m_partials(partials)
+  {
+  }
+
+  void write(const template_type& tmpl) {
+    std::string body;
+    statements(tmpl, body);
+    m_out << "void " << m_id << context(body) << body << "}\n\n";
+  }
+
+ private:
+  std::ostream& m_out;
+  const std::string& m_id;
+  const std::map<std::string, std::string>& m_partials;
+  std::size_t m_count = 0;
+
+  // parameters are left unnamed when the function doesn't use them, so the
+  // generated code builds without unused parameter warnings
+  static std::string context(const std::string& body) {
+    return body.empty() ? "(static_context&) {\n" : "(static_context& c) {\n";
+  }
+
+  std::string path(const token& tag) {
+    auto name = m_id + "_path" + std::to_string(m_count++);
+    m_out << "const std::string_view " << name << "[] = {";
+    for (auto& segment: tag.path())
+      m_out << literal(segment) << ", ";
+    m_out << "};\n";
+    return name + ", " + std::to_string(tag.path().size());
+  }
+
+  // Follows render_context::render: the prefix of a partial goes before every
+  // instruction that starts a line, and before a trailing token without an
+  // instruction, like a section end or a comment, that starts one.
+  void statements(code_range code, std::string& out) {
+    std::string text;
+    auto flush = [&] {
+      if (!text.empty())
+        out += "  c.text(" + literal(text) + ");\n";
+      text.clear();
+    };
+    bool prev_eol = !code.section();
+    for (auto it = code.begin(); it != code.end(); ++it) {
+      auto& tag = it->source();
+      if (prev_eol) {
+        flush();
+        out += "  c.prefix();\n";
+      }
+      switch (it->code()) {
+        case instruction::op::text:
+          text += tag.raw();
+          break;
+        case instruction::op::variable:
+        case instruction::op::unescaped_variable:
+          flush();
+          out += "  c.variable(" + path(tag) + ", " +
+              (it->code() == instruction::op::variable ? "true" : "false") +
+              ");\n";
+          break;
+        case instruction::op::section:
+        case instruction::op::inverted_section: {
+          flush();
+          auto name = section(*it);
+          out += std::string("  c.") +
+              (it->code() == instruction::op::section ?
+                  "section(" : "inverted_section(") +
+              path(tag) + ", " + name + ");\n";
+          break;
+        }
+        case instruction::op::partial: {
+          flush();
+          auto partial = m_partials.find(std::string{tag.name()});
+          if (partial != m_partials.end())
+            out += "  c.partial(&" + partial->second + ", " +
+                literal(tag.partial_prefix()) + ");\n";
+          break;
+        }
+      }
+      prev_eol = it->eol();
+      it += it->body_size();
+    }
+    flush();
+    if (code.tail() && prev_eol)
+      out += "  c.prefix();\n";
+  }
+
+  std::string section(const instruction& open) {
+    auto name = m_id + "_section" + std::to_string(m_count++);
+    std::string body;
+    statements(template_type::body(open), body);
+    m_out << "void " << name << "_body" << context(body) << body << "}\n\n";
+
+    // the body as section_str in render_section builds it
+    std::string statements, text;
+    bool eol = false;
+    for (auto& tag: template_type::section_tokens(open.source())) {
+      text += tag.raw();
+      if (tag.eol()) {
+        statements += "  out.append(" + literal(text) + ");\n"
+            "  out.append(prefix);\n";
+        text.clear();
+        eol = true;
+      }
+    }
+    if (!text.empty())
+      statements += "  out.append(" + literal(text) + ");\n";
+    m_out << "void " << name << "_text(std::string&"
+        << (statements.empty() ? "" : " out") << ", std::string_view"
+        << (eol ? " prefix" : "") << ") {\n" << statements << "}\n\n";
+
+    auto delims = open.source().delims();
+    m_out << "const static_section " << name << "{&" << name << "_body, &"
+        << name << "_text,\n    "
+        << literal(template_type::section_source(open.source())) << ",\n    "
+        << literal(delims.first) << ", " << literal(delims.second)
+        << "};\n\n";
+    return name;
+  }
+};
+
+void generator::write(std::ostream& header, std::ostream& source,
+    const std::string& include, const std::string& ns) const
+{
+  header << "// Generated by mstch_codegen, do not edit.\n\n"
+      << "#pragma once\n\n#include <string>\n\n#include \"mstch/mstch.hpp\"\n\n";
+  if (!ns.empty())
+    header << "namespace " << ns << " {\n\n";
+  for (auto& exported: m_exported)
+    header << "void render_" << exported.first
+        << "(const mstch::node& root, std::string& out);\n"
+        << "std::string render_" << exported.first
+        << "(const mstch::node& root);\n";
+  if (!ns.empty())
+    header << "\n}\n";
+
+  source << "// Generated by mstch_codegen, do not edit.\n\n"
+      << "#include \"" << include << "\"\n\n"
+      << "#include <string_view>\n\n"
+      << "#include \"mstch/static_template.hpp\"\n\n"
+      << "namespace {\n\n"
+      << "using mstch::internal::static_context;\n"
+      << "using mstch::internal::static_section;\n\n";
+  for (std::size_t i = 0; i < m_units.size(); ++i)
+    source << "void t" << i << "(static_context& c);\n";
+  source << "\n";
+
+  // partial tags compiled at run time, in section lambda bodies and lambda
+  // results, find the partials here
+  if (!m_partials.empty()) {
+    source << "const mstch::partial_registry& partials() {\n"
+        << "  static const mstch::partial_registry registry{\n";
+    for (auto& partial: m_partials)
+      source << "      {std::string{" << literal(partial.first)
+          << "}, std::string{" << literal(m_units[partial.second].source)
+          << "}},\n";
+    source << "  };\n  return registry;\n}\n\n";
+  }
+
+  std::map<std::string, std::string> partials;
+  for (auto& partial: m_partials)
+    partials[partial.first] = "t" + std::to_string(partial.second);
+  for (std::size_t i = 0; i < m_units.size(); ++i) {
+    source << "// " << m_units[i].path << "\n\n";
+    auto id = "t" + std::to_string(i);
+    unit_writer(source, id, partials).write(*m_units[i].tmpl);
+  }
+  source << "}\n\n";
+
+  auto prefix = ns.empty() ? std::string{} : ns + "::";
+  for (auto& exported: m_exported) {
+    source << "void " << prefix << "render_" << exported.first
+        << "(const mstch::node& root, std::string& out) {\n"
+        << "  static_context c{root, out"
+        << (m_partials.empty() ? "" : ", partials()") << "};\n"
+        << "  t" << exported.second << "(c);\n}\n\n"
+        << "std::string " << prefix << "render_" << exported.first
+        << "(const mstch::node& root) {\n"
+        << "  std::string out;\n"
+        << "  render_" << exported.first << "(root, out);\n"
+        << "  return out;\n}\n\n";
+  }
+}
+
+void usage() {
+  std::cerr << "usage: mstch_codegen --header out.hpp --source out.cpp "
+      "[--include path] [--namespace ns] [--partial name=file]... "
+      "template...\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+  std::string header_path, source_path, include, ns;
+  generator gen;
+  try {
+    std::vector<std::string> templates;
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg.compare(0, 2, "--") != 0) {
+        templates.push_back(arg);
+        continue;
+      }
+      if (i + 1 == argc) {
+        usage();
+        return 2;
+      }
+      std::string value = argv[++i];
+      if (arg == "--header") {
+        header_path = value;
+      } else if (arg == "--source") {
+        source_path = value;
+      } else if (arg == "--include") {
+        include = value;
+      } else if (arg == "--namespace") {
+        ns = value;
+      } else if (arg == "--partial") {
+        auto eq = value.find('=');
+        if (eq == std::string::npos) {
+          usage();
+          return 2;
+        }
+        gen.add_partial(value.substr(0, eq), value.substr(eq + 1));
+      } else {
+        usage();
+        return 2;
+      }
+    }
+    if (header_path.empty() || source_path.empty() || templates.empty()) {
+      usage();
+      return 2;
+    }
+    for (auto& path: templates)
+      gen.add_template(path);
+    if (include.empty())
+      include = header_path.substr(header_path.find_last_of("/\\") + 1);
+
+    std::ofstream header(header_path, std::ios::binary);
+    std::ofstream source(source_path, std::ios::binary);
+    gen.write(header, source, include, ns);
+    if (!header || !source)
+      throw std::runtime_error("can't write " + header_path + " or " + source_path);
+  } catch (const std::exception& e) {
+    std::cerr << "mstch_codegen: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}